@@ -0,0 +1,327 @@
+/****************************************************************************
+ * AHRS.cpp
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Madgwick and Mahony orientation filters fed by IMU samples.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ *
+ * NOTE       : The filter equations follow S. Madgwick, "An efficient
+ *              orientation filter for inertial and inertial/magnetic sensor
+ *              arrays" (2010), and his reference MadgwickAHRS/MahonyAHRS code.
+ ****************************************************************************/
+
+
+#include <math.h>
+#include "AHRS.h"
+
+#if defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+
+#define DEG_TO_RAD 0.017453292519943295f
+#define RAD_TO_DEG 57.29577951308232f
+
+/* hardware reciprocal square root estimate refined by Newton-Raphson, to ~1e-7 relative; 'x' must be > 0 */
+static inline float invSqrt(float x) {
+#if defined(__SSE__) || defined(__x86_64__)
+	float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));		// 12 bits
+	return y * (1.5f - 0.5f * x * y * y);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	float32x2_t v = vdup_n_f32(x);
+	float32x2_t y = vrsqrte_f32(v);								// 8 bits
+	y = vmul_f32(y, vrsqrts_f32(vmul_f32(v, y), y));
+	y = vmul_f32(y, vrsqrts_f32(vmul_f32(v, y), y));
+	return vget_lane_f32(y, 0);
+#else
+	return 1.0f / sqrtf(x);
+#endif
+}
+
+
+AHRS::AHRS(ahrs_algorithm_t algorithm, float sample_rate) {
+	this->algorithm = algorithm;
+	beta = AHRS_MADGWICK_BETA;
+	setMahonyGains(AHRS_MAHONY_KP, AHRS_MAHONY_KI);
+	setSampleRate(sample_rate);
+	useMag = false;
+	reset();
+}
+
+void AHRS::reset() {
+	q0 = 1.0f;
+	q1 = q2 = q3 = 0.0f;
+	ix = iy = iz = 0.0f;
+	lastTimestamp = 0;
+}
+
+void AHRS::setMadgwickGain(float beta) {
+	this->beta = beta;
+}
+
+void AHRS::setMahonyGains(float kp, float ki) {
+	twoKp = 2.0f * kp;
+	twoKi = 2.0f * ki;
+}
+
+void AHRS::setSampleRate(float sample_rate) {
+	period = (sample_rate > 0) ? 1.0f / sample_rate : 1.0f / IMU_BASE_ODR;
+}
+
+void AHRS::setMagEnabled(bool enabled) {
+	useMag = enabled;
+}
+
+/* step from the previous sample to this one, the nominal period when the timestamps cannot be trusted */
+float AHRS::stepFor(uint64_t timestamp) {
+	float dt = period;
+	if (timestamp != 0 && lastTimestamp != 0 && timestamp > lastTimestamp) {
+		float elapsed = (float)(timestamp - lastTimestamp) * 1e-9f;
+		if (elapsed <= AHRS_MAX_DT) dt = elapsed;
+	}
+	if (timestamp != 0) lastTimestamp = timestamp;
+
+	return dt;
+}
+
+void AHRS::update(const ICM20948::imu_t& sample) {
+	update(sample, stepFor(sample.timestamp));
+}
+
+void AHRS::update(const ICM20948::imu_t& sample, float dt) {
+	float gx = sample.gx * DEG_TO_RAD, gy = sample.gy * DEG_TO_RAD, gz = sample.gz * DEG_TO_RAD;
+	bool mag = useMag && (sample.mx != 0.0f || sample.my != 0.0f || sample.mz != 0.0f);
+	float mx = mag ? sample.mx : 0.0f, my = mag ? sample.my : 0.0f, mz = mag ? sample.mz : 0.0f;
+
+	if (algorithm == AHRS_MAHONY) {
+		mahony(gx, gy, gz, sample.ax, sample.ay, sample.az, mx, my, mz, dt);
+	} else if (mag) {
+		madgwick(gx, gy, gz, sample.ax, sample.ay, sample.az, mx, my, mz, dt);
+	} else {
+		madgwick(gx, gy, gz, sample.ax, sample.ay, sample.az, dt);
+	}
+}
+
+void AHRS::update(const ICM20948::imu_t* samples, size_t count) {
+	for (size_t i = 0; i < count; i++) update(samples[i]);
+}
+
+
+/********************************* Madgwick *********************************/
+
+void AHRS::madgwick(float gx, float gy, float gz, float ax, float ay, float az, float dt) {
+	/* rate of change of the quaternion from the gyroscope */
+	float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+	float qDot1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+	float qDot2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+	float qDot3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+	/* gradient descent step towards gravity, skipped in free fall */
+	float norm = ax * ax + ay * ay + az * az;
+	if (norm > 0.0f) {
+		float recipNorm = invSqrt(norm);
+		ax *= recipNorm;
+		ay *= recipNorm;
+		az *= recipNorm;
+
+		float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+		float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+		float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+		float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+		float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+		float s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+		float s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+		float s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+
+		norm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+		if (norm > 0.0f) {
+			recipNorm = beta * invSqrt(norm);
+			qDot0 -= recipNorm * s0;
+			qDot1 -= recipNorm * s1;
+			qDot2 -= recipNorm * s2;
+			qDot3 -= recipNorm * s3;
+		}
+	}
+
+	q0 += qDot0 * dt;
+	q1 += qDot1 * dt;
+	q2 += qDot2 * dt;
+	q3 += qDot3 * dt;
+
+	float recipNorm = invSqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+	q0 *= recipNorm;
+	q1 *= recipNorm;
+	q2 *= recipNorm;
+	q3 *= recipNorm;
+}
+
+void AHRS::madgwick(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz, float dt) {
+	float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+	float qDot1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+	float qDot2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+	float qDot3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+	float norm = ax * ax + ay * ay + az * az;
+	if (norm > 0.0f) {
+		float recipNorm = invSqrt(norm);
+		ax *= recipNorm;
+		ay *= recipNorm;
+		az *= recipNorm;
+
+		recipNorm = invSqrt(mx * mx + my * my + mz * mz);
+		mx *= recipNorm;
+		my *= recipNorm;
+		mz *= recipNorm;
+
+		float _2q0mx = 2.0f * q0 * mx, _2q0my = 2.0f * q0 * my, _2q0mz = 2.0f * q0 * mz, _2q1mx = 2.0f * q1 * mx;
+		float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+		float _2q0q2 = 2.0f * q0 * q2, _2q2q3 = 2.0f * q2 * q3;
+		float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+		float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+		float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+
+		/* reference direction of the earth's field, in the horizontal/vertical plane */
+		float hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 + _2q1 * my * q2 + _2q1 * mz * q3 - mx * q2q2 - mx * q3q3;
+		float hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 - my * q1q1 + my * q2q2 + _2q2 * mz * q3 - my * q3q3;
+		float _2bx = sqrtf(hx * hx + hy * hy);
+		float _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 - mz * q1q1 + _2q2 * my * q3 - mz * q2q2 + mz * q3q3;
+		float _4bx = 2.0f * _2bx, _4bz = 2.0f * _2bz;
+
+		/* objective function errors, shared by the four gradient terms */
+		float ex = 2.0f * q1q3 - _2q0q2 - ax;
+		float ey = 2.0f * q0q1 + _2q2q3 - ay;
+		float ez = 1.0f - 2.0f * q1q1 - 2.0f * q2q2 - az;
+		float fx = _2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx;
+		float fy = _2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my;
+		float fz = _2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz;
+
+		float s0 = -_2q2 * ex + _2q1 * ey - _2bz * q2 * fx + (-_2bx * q3 + _2bz * q1) * fy + _2bx * q2 * fz;
+		float s1 = _2q3 * ex + _2q0 * ey - 4.0f * q1 * ez + _2bz * q3 * fx + (_2bx * q2 + _2bz * q0) * fy +
+				   (_2bx * q3 - _4bz * q1) * fz;
+		float s2 = -_2q0 * ex + _2q3 * ey - 4.0f * q2 * ez + (-_4bx * q2 - _2bz * q0) * fx + (_2bx * q1 + _2bz * q3) * fy +
+				   (_2bx * q0 - _4bz * q2) * fz;
+		float s3 = _2q1 * ex + _2q2 * ey + (-_4bx * q3 + _2bz * q1) * fx + (-_2bx * q0 + _2bz * q2) * fy + _2bx * q1 * fz;
+
+		norm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+		if (norm > 0.0f) {
+			recipNorm = beta * invSqrt(norm);
+			qDot0 -= recipNorm * s0;
+			qDot1 -= recipNorm * s1;
+			qDot2 -= recipNorm * s2;
+			qDot3 -= recipNorm * s3;
+		}
+	}
+
+	q0 += qDot0 * dt;
+	q1 += qDot1 * dt;
+	q2 += qDot2 * dt;
+	q3 += qDot3 * dt;
+
+	float recipNorm = invSqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+	q0 *= recipNorm;
+	q1 *= recipNorm;
+	q2 *= recipNorm;
+	q3 *= recipNorm;
+}
+
+
+/********************************** Mahony **********************************/
+
+/* a zero field (mx = my = mz = 0) runs the accelerometer-only variant */
+void AHRS::mahony(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz, float dt) {
+	float norm = ax * ax + ay * ay + az * az;
+	if (norm > 0.0f) {
+		float recipNorm = invSqrt(norm);
+		ax *= recipNorm;
+		ay *= recipNorm;
+		az *= recipNorm;
+
+		/* half the estimated direction of gravity, and the error to the measured one */
+		float halfvx = q1 * q3 - q0 * q2;
+		float halfvy = q0 * q1 + q2 * q3;
+		float halfvz = q0 * q0 - 0.5f + q3 * q3;
+		float halfex = ay * halfvz - az * halfvy;
+		float halfey = az * halfvx - ax * halfvz;
+		float halfez = ax * halfvy - ay * halfvx;
+
+		norm = mx * mx + my * my + mz * mz;
+		if (norm > 0.0f) {
+			recipNorm = invSqrt(norm);
+			mx *= recipNorm;
+			my *= recipNorm;
+			mz *= recipNorm;
+
+			float q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+			float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+			float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+
+			float hx = 2.0f * (mx * (0.5f - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2));
+			float hy = 2.0f * (mx * (q1q2 + q0q3) + my * (0.5f - q1q1 - q3q3) + mz * (q2q3 - q0q1));
+			float bx = sqrtf(hx * hx + hy * hy);
+			float bz = 2.0f * (mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (0.5f - q1q1 - q2q2));
+
+			float halfwx = bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2);
+			float halfwy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3);
+			float halfwz = bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2);
+			halfex += my * halfwz - mz * halfwy;
+			halfey += mz * halfwx - mx * halfwz;
+			halfez += mx * halfwy - my * halfwx;
+		}
+
+		if (twoKi > 0.0f) {
+			ix += twoKi * halfex * dt;
+			iy += twoKi * halfey * dt;
+			iz += twoKi * halfez * dt;
+			gx += ix;
+			gy += iy;
+			gz += iz;
+		}
+
+		gx += twoKp * halfex;
+		gy += twoKp * halfey;
+		gz += twoKp * halfez;
+	}
+
+	gx *= 0.5f * dt;
+	gy *= 0.5f * dt;
+	gz *= 0.5f * dt;
+	float qa = q0, qb = q1, qc = q2;
+	q0 += -qb * gx - qc * gy - q3 * gz;
+	q1 += qa * gx + qc * gz - q3 * gy;
+	q2 += qa * gy - qb * gz + q3 * gx;
+	q3 += qa * gz + qb * gy - qc * gx;
+
+	float recipNorm = invSqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+	q0 *= recipNorm;
+	q1 *= recipNorm;
+	q2 *= recipNorm;
+	q3 *= recipNorm;
+}
+
+
+/********************************** Output **********************************/
+
+AHRS::quat_t AHRS::getQuaternion() {
+	return {q0, q1, q2, q3};
+}
+
+AHRS::euler_t AHRS::getEuler() {
+	euler_t euler;
+	float sinPitch = 2.0f * (q0 * q2 - q3 * q1);
+	if (sinPitch > 1.0f) sinPitch = 1.0f;
+	if (sinPitch < -1.0f) sinPitch = -1.0f;
+
+	euler.roll = atan2f(2.0f * (q0 * q1 + q2 * q3), 1.0f - 2.0f * (q1 * q1 + q2 * q2)) * RAD_TO_DEG;
+	euler.pitch = asinf(sinPitch) * RAD_TO_DEG;
+	euler.yaw = atan2f(2.0f * (q0 * q3 + q1 * q2), 1.0f - 2.0f * (q2 * q2 + q3 * q3)) * RAD_TO_DEG;
+
+	return euler;
+}
@@ -0,0 +1,86 @@
+/****************************************************************************
+ * AHRS.h
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Madgwick and Mahony orientation filters fed by IMU samples.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#ifndef AHRS_H
+#define AHRS_H
+
+/********************************* Includes *********************************/
+#include <stdint.h>
+#include <stddef.h>
+#include "ICM20948.h"
+
+/********************************* Defines **********************************/
+#define AHRS_MADGWICK_BETA 0.1f 		// gradient descent gain
+#define AHRS_MAHONY_KP     1.0f 		// proportional gain
+#define AHRS_MAHONY_KI     0.0f 		// integral gain, 0 disables the gyroscope bias estimate
+#define AHRS_MAX_DT        0.1f 		// [s] larger gaps between timestamps fall back to the nominal period
+
+enum ahrs_algorithm_t {
+	AHRS_MADGWICK,
+	AHRS_MAHONY
+};
+
+/*********************************** AHRS ***********************************/
+
+/*
+ * Fuses the gyroscope with the accelerometer (and the magnetometer, when enabled and present in the samples) into a
+ * unit quaternion rotating the sensor frame into the earth frame. The integration step of each sample is the
+ * difference between its timestamp and the previous one, so irregular acquisition (dropped samples, FIFO batches,
+ * polling jitter) does not bend the estimate; samples without a usable timestamp advance by 1 / sample rate.
+ *
+ * One instance tracks one sensor. Each update is a few dozen multiply-adds and a handful of reciprocal square roots,
+ * with no branches in the common path, so a single core can keep many sensors at the full 1125 Hz.
+ */
+class AHRS {
+public:
+	struct quat_t {
+		float w, x, y, z;
+	};
+
+	struct euler_t {
+		float roll, pitch, yaw;			// [deg]
+	};
+
+private:
+	ahrs_algorithm_t algorithm;
+	float q0, q1, q2, q3;
+	float beta;							// Madgwick
+	float twoKp, twoKi;					// Mahony
+	float ix, iy, iz;					// Mahony integral feedback [rad/s]
+	bool useMag;
+	float period;						// [s] nominal step
+	uint64_t lastTimestamp;
+
+	float stepFor(uint64_t timestamp);
+	void madgwick(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+	void madgwick(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz, float dt);
+	void mahony(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz, float dt);
+
+public:
+	explicit AHRS(ahrs_algorithm_t algorithm = AHRS_MADGWICK, float sample_rate = IMU_BASE_ODR);
+	void reset();								// back to the identity orientation
+	void setMadgwickGain(float beta);
+	void setMahonyGains(float kp, float ki);
+	void setSampleRate(float sample_rate);		// [Hz] fallback when timestamps are missing
+	void setMagEnabled(bool enabled);			// off by default, samples with a zero field are fused without it
+
+	void update(const ICM20948::imu_t& sample);
+	void update(const ICM20948::imu_t& sample, float dt);	// explicit step [s], ignores the timestamp
+	void update(const ICM20948::imu_t* samples, size_t count);
+
+	AHRS::quat_t getQuaternion();
+	AHRS::euler_t getEuler();
+};
+
+#endif	// AHRS_H
@@ -0,0 +1,200 @@
+/****************************************************************************
+ * AsyncWriter.cpp
+ *
+ * About      : Buffer-pool file writer that keeps storage latency off the
+ *              acquisition thread.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "AsyncWriter.h"
+
+
+static uint64_t nowNs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+AsyncWriter::AsyncWriter() {
+	fd = -1;
+	current = -1;
+	fullHead = fullCount = 0;
+	writing = stopping = false;
+	memset(&stats, 0, sizeof(stats));
+}
+
+AsyncWriter::~AsyncWriter() {
+	close();
+}
+
+int AsyncWriter::open(std::string path, async_policy_t policy, int sync_every, size_t buffer_size, int buffer_count) {
+	close();
+	if (buffer_count < 2 || buffer_size == 0) return -1;
+
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) return -1;
+
+	this->policy = policy;
+	syncEvery = sync_every;
+	bufferSize = (buffer_size + ASYNC_BUFFER_ALIGN - 1) / ASYNC_BUFFER_ALIGN * ASYNC_BUFFER_ALIGN;
+
+	/* the whole pool is allocated up front, append() never allocates */
+	buffers.assign(buffer_count, NULL);
+	lengths.assign(buffer_count, 0);
+	freeList.clear();
+	freeList.reserve(buffer_count);
+	fullQueue.assign(buffer_count, -1);
+	for (int i = 0; i < buffer_count; i++) {
+		void* mem = NULL;
+		if (posix_memalign(&mem, ASYNC_BUFFER_ALIGN, bufferSize) != 0) {
+			for (int j = 0; j < i; j++) free(buffers[j]);
+			buffers.clear();
+			::close(fd);
+			fd = -1;
+			return -1;
+		}
+		buffers[i] = (uint8_t*)mem;
+		freeList.push_back(i);
+	}
+
+	current = -1;
+	fullHead = fullCount = 0;
+	writing = stopping = false;
+	memset(&stats, 0, sizeof(stats));
+	writer = std::thread(&AsyncWriter::writerLoop, this);
+
+	return 0;
+}
+
+int AsyncWriter::acquire() {
+	std::unique_lock<std::mutex> guard(lock);
+
+	if (freeList.empty()) {
+		if (policy == ASYNC_DROP) return -1;
+		stats.stalls++;
+		bufferFree.wait(guard, [this] { return !freeList.empty(); });
+	}
+
+	int buffer = freeList.back();
+	freeList.pop_back();
+	lengths[buffer] = 0;
+
+	return buffer;
+}
+
+void AsyncWriter::submit() {
+	if (current < 0) return;
+
+	std::lock_guard<std::mutex> guard(lock);
+	fullQueue[(fullHead + fullCount) % fullQueue.size()] = current;
+	fullCount++;
+	current = -1;
+	bufferFull.notify_one();
+}
+
+int AsyncWriter::append(const void* data, size_t len) {
+	if (fd < 0 || len > bufferSize) return -1;
+
+	if (current >= 0 && lengths[current] + len > bufferSize) submit();
+	if (current < 0) current = acquire();
+	if (current < 0) {
+		std::lock_guard<std::mutex> guard(lock);
+		stats.appends_dropped++;
+		return -1;
+	}
+
+	memcpy(buffers[current] + lengths[current], data, len);
+	lengths[current] += len;
+
+	return 0;
+}
+
+void AsyncWriter::writerLoop() {
+	int written = 0;
+
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		bufferFull.wait(guard, [this] { return fullCount > 0 || stopping; });
+		if (fullCount == 0) break;		// stopping and drained
+
+		int buffer = fullQueue[fullHead];
+		fullHead = (fullHead + 1) % fullQueue.size();
+		fullCount--;
+		writing = true;
+		guard.unlock();
+
+		/* the disk is only touched without the lock held */
+		uint64_t start = nowNs();
+		const uint8_t* data = buffers[buffer];
+		size_t len = lengths[buffer];
+		int status = 0;
+		while (len > 0) {
+			ssize_t n = ::write(fd, data, len);
+			if (n < 0) {
+				if (errno == EINTR) continue;
+				status = -1;
+				break;
+			}
+			data += n;
+			len -= n;
+		}
+		if (status == 0 && syncEvery > 0 && ++written % syncEvery == 0 && fdatasync(fd) < 0) status = -1;
+		uint64_t elapsed = nowNs() - start;
+
+		guard.lock();
+		if (status < 0) stats.errors++;
+		stats.bytes_written += lengths[buffer] - len;
+		stats.buffers_written++;
+		if (elapsed > stats.max_write_ns) stats.max_write_ns = elapsed;
+		freeList.push_back(buffer);
+		writing = false;
+		bufferFree.notify_all();
+	}
+}
+
+int AsyncWriter::flush() {
+	if (fd < 0) return -1;
+	submit();
+
+	std::unique_lock<std::mutex> guard(lock);
+	bufferFree.wait(guard, [this] { return fullCount == 0 && !writing; });
+
+	return (stats.errors > 0) ? -1 : 0;
+}
+
+int AsyncWriter::close() {
+	if (fd < 0) return 0;
+
+	int status = flush();
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+		bufferFull.notify_one();
+	}
+	writer.join();
+
+	if (syncEvery > 0 && fdatasync(fd) < 0) status = -1;
+	if (::close(fd) < 0) status = -1;
+	fd = -1;
+
+	for (size_t i = 0; i < buffers.size(); i++) free(buffers[i]);
+	buffers.clear();
+
+	return status;
+}
+
+AsyncWriter::stats_t AsyncWriter::getStats() {
+	std::lock_guard<std::mutex> guard(lock);
+	return stats;
+}
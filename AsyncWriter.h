@@ -0,0 +1,95 @@
+/****************************************************************************
+ * AsyncWriter.h
+ *
+ * About      : Buffer-pool file writer that keeps storage latency off the
+ *              acquisition thread.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+/********************************* Includes *********************************/
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/********************************* Defines **********************************/
+#define ASYNC_BUFFER_SIZE   (64 * 1024) 	// bytes per buffer, a multiple of ASYNC_BUFFER_ALIGN
+#define ASYNC_BUFFER_COUNT  4 				// buffers in the pool
+#define ASYNC_BUFFER_ALIGN  4096 			// buffers are page aligned
+
+/* what append() does when every buffer is waiting for the disk */
+enum async_policy_t {
+	ASYNC_BLOCK,						// wait for the writer thread (backpressure)
+	ASYNC_DROP							// discard the data and count it, never wait
+};
+
+/******************************* AsyncWriter ********************************/
+
+/*
+ * The producer copies data into the current buffer of a small pool. Full buffers are handed to a dedicated writer
+ * thread, which issues one large write() per buffer (and an fdatasync() every 'sync_every' buffers) and then returns
+ * the buffer to the pool. The producer only touches the lock when it swaps buffers, so a slow disk stalls the
+ * acquisition thread only once the whole pool is queued -- and not at all with ASYNC_DROP.
+ *
+ * append() never splits a chunk across buffers, so a dropped buffer always drops whole records.
+ */
+class AsyncWriter {
+public:
+	struct stats_t {
+		uint64_t bytes_written;
+		uint64_t buffers_written;
+		uint64_t appends_dropped;		// append() calls discarded under ASYNC_DROP
+		uint64_t stalls;				// times append() had to wait for a free buffer under ASYNC_BLOCK
+		uint64_t max_write_ns;			// slowest write() (+ fdatasync()) seen by the writer thread
+		int errors;
+	};
+
+private:
+	int fd;
+	async_policy_t policy;
+	int syncEvery;
+	size_t bufferSize;
+
+	std::vector<uint8_t*> buffers;
+	std::vector<size_t> lengths;
+	int current;						// buffer being filled by the producer, -1 if none
+	std::vector<int> freeList;			// buffers ready to be filled
+	std::vector<int> fullQueue;			// buffers waiting for the disk, in order (circular)
+	size_t fullHead, fullCount;
+	bool writing, stopping;
+	stats_t stats;
+
+	std::mutex lock;
+	std::condition_variable bufferFree, bufferFull;
+	std::thread writer;
+
+	int acquire();						// takes a free buffer for the producer, -1 if none (ASYNC_DROP)
+	void submit();						// queues the current buffer for the writer thread
+	void writerLoop();
+
+public:
+	AsyncWriter();
+	~AsyncWriter();
+	AsyncWriter(const AsyncWriter&) = delete;
+	AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+	int open(std::string path, async_policy_t policy = ASYNC_BLOCK, int sync_every = 0,
+			 size_t buffer_size = ASYNC_BUFFER_SIZE, int buffer_count = ASYNC_BUFFER_COUNT);
+	bool isOpen() { return fd >= 0; }
+	int append(const void* data, size_t len);		// 0 on success, -1 if the data was dropped or on error
+	int flush();									// writes out everything appended so far and waits for it
+	int close();
+	AsyncWriter::stats_t getStats();
+};
+
+#endif	// ASYNC_WRITER_H
@@ -0,0 +1,114 @@
+/****************************************************************************
+ * DataReady.cpp
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Event sources used to wait for the IMU data-ready interrupt.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include "DataReady.h"
+
+
+/******************************* GPIOLineSource *****************************/
+
+GPIOLineSource::GPIOLineSource(std::string chip, uint32_t line) {
+	fd = -1;
+
+	int chipFd = open(chip.c_str(), O_RDONLY | O_CLOEXEC);
+	if (chipFd < 0) return;
+
+	struct gpioevent_request request;
+	memset(&request, 0, sizeof(request));
+	request.lineoffset = line;
+	request.handleflags = GPIOHANDLE_REQUEST_INPUT;
+	request.eventflags = GPIOEVENT_REQUEST_RISING_EDGE;
+	strncpy(request.consumer_label, "icm20948-drdy", sizeof(request.consumer_label) - 1);
+
+	/* the event descriptor stays valid after the chip descriptor is closed */
+	if (ioctl(chipFd, GPIO_GET_LINEEVENT_IOCTL, &request) == 0) fd = request.fd;
+	close(chipFd);
+}
+
+GPIOLineSource::~GPIOLineSource() {
+	if (fd >= 0) close(fd);
+}
+
+int GPIOLineSource::acknowledge() {
+	/* a single read returns every queued edge */
+	struct gpioevent_data events[16];
+	ssize_t len = read(fd, events, sizeof(events));
+	if (len < 0) return -1;
+
+	return len / sizeof(struct gpioevent_data);
+}
+
+
+/******************************* EventFDSource ******************************/
+
+EventFDSource::EventFDSource() {
+	fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+}
+
+EventFDSource::~EventFDSource() {
+	if (fd >= 0) close(fd);
+}
+
+int EventFDSource::signal(uint64_t events) {
+	return (write(fd, &events, sizeof(events)) == sizeof(events)) ? 0 : -1;
+}
+
+int EventFDSource::acknowledge() {
+	uint64_t events;
+	if (read(fd, &events, sizeof(events)) != sizeof(events)) return (errno == EAGAIN) ? 0 : -1;
+
+	return (int)events;
+}
+
+
+/******************************* DataReadyWaiter ****************************/
+
+DataReadyWaiter::DataReadyWaiter(WaitSource* source) {
+	this->source = source;
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	if (epfd >= 0 && epoll_ctl(epfd, EPOLL_CTL_ADD, source->getFd(), &event) < 0) {
+		int error = errno;
+		close(epfd);
+		epfd = -1;
+		errno = error;
+	}
+}
+
+DataReadyWaiter::~DataReadyWaiter() {
+	if (epfd >= 0) close(epfd);
+}
+
+int DataReadyWaiter::wait(int timeout_ms) {
+	if (epfd < 0) return -1;
+
+	struct epoll_event event;
+	int ready;
+	do {
+		ready = epoll_wait(epfd, &event, 1, timeout_ms);
+	} while (ready < 0 && errno == EINTR);
+
+	if (ready <= 0) return ready;
+	return source->acknowledge();
+}
@@ -0,0 +1,88 @@
+/****************************************************************************
+ * DataReady.h
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Event sources used to wait for the IMU data-ready interrupt.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#ifndef DATA_READY_H
+#define DATA_READY_H
+
+/********************************* Includes *********************************/
+#include <stdint.h>
+#include <string>
+
+/********************************** Defines *********************************/
+#define DRDY_TIMEOUT_INF -1 		// wait without a timeout
+
+/******************************* Wait Sources *******************************/
+
+/*
+ * A wait source is anything that can be polled for "new data is available". The acquisition code only ever sees the
+ * pollable descriptor, so the GPIO interrupt line can be swapped for an eventfd (or anything else) in tests.
+ */
+class WaitSource {
+public:
+	virtual ~WaitSource() {}
+	virtual int getFd() = 0;					// descriptor that becomes readable when an event is pending
+	virtual int acknowledge() = 0;				// consumes the pending events, returns how many or -1 on error
+};
+
+/* rising edges on a line of a Linux GPIO character device (/dev/gpiochipN), e.g. the IMU's INT1 pin */
+class GPIOLineSource : public WaitSource {
+private:
+	int fd;
+
+public:
+	GPIOLineSource(std::string chip, uint32_t line);
+	~GPIOLineSource();
+	GPIOLineSource(const GPIOLineSource&) = delete;
+	GPIOLineSource& operator=(const GPIOLineSource&) = delete;
+
+	bool isOpen() { return fd >= 0; }
+	int getFd() { return fd; }
+	int acknowledge();
+};
+
+/* an eventfd that is signalled from software */
+class EventFDSource : public WaitSource {
+private:
+	int fd;
+
+public:
+	EventFDSource();
+	~EventFDSource();
+	EventFDSource(const EventFDSource&) = delete;
+	EventFDSource& operator=(const EventFDSource&) = delete;
+
+	int signal(uint64_t events = 1);
+	int getFd() { return fd; }
+	int acknowledge();
+};
+
+/******************************* DataReadyWaiter ****************************/
+
+/* sleeps in epoll until the wait source fires, so an idle acquisition loop costs no CPU */
+class DataReadyWaiter {
+private:
+	int epfd;
+	WaitSource* source;
+
+public:
+	explicit DataReadyWaiter(WaitSource* source);
+	~DataReadyWaiter();
+	DataReadyWaiter(const DataReadyWaiter&) = delete;
+	DataReadyWaiter& operator=(const DataReadyWaiter&) = delete;
+
+	bool isValid() { return epfd >= 0; }			// false if the epoll set could not be created, wait() always fails
+	int wait(int timeout_ms = DRDY_TIMEOUT_INF);	// returns the number of events, 0 on timeout, -1 on error
+};
+
+#endif	// DATA_READY_H
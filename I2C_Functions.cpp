@@ -10,7 +10,150 @@
  * Property of ADAMUS lab, University of Florida.
  ****************************************************************************/
 
+#include <errno.h>
+#include <string.h>
+#include <time.h>
 #include "I2C_Functions.h"
+#include "Trace.h"
+
+/*************************** I2C Bus ***************************/
+
+static uint64_t monotonic_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+I2C_Bus::I2C_Bus(uint8_t bus, std::shared_ptr<I2C_Transport> transport) {
+	this->bus = bus;
+	for (int i = 0; i < 128; i++) metrics[i].store(NULL, std::memory_order_relaxed);
+	set_transport(transport);
+}
+
+I2C_Bus::~I2C_Bus() {
+	for (int i = 0; i < 128; i++) delete metrics[i].load();
+}
+
+/* buses are only tracked weakly, so the handle is released as soon as no device uses it anymore */
+static std::mutex registry_lock;
+static std::map<uint8_t, std::weak_ptr<I2C_Bus>> registry;
+static std::map<uint8_t, std::shared_ptr<I2C_Transport>> attached;		// transports that replace /dev/i2c-N
+
+std::shared_ptr<I2C_Bus> I2C_Bus::get(uint8_t bus) {
+	std::lock_guard<std::mutex> guard(registry_lock);
+	std::shared_ptr<I2C_Bus> shared = registry[bus].lock();
+	if (!shared) {
+		auto it = attached.find(bus);
+		shared = std::make_shared<I2C_Bus>(bus, (it != attached.end()) ? it->second : nullptr);
+		registry[bus] = shared;
+	}
+
+	return shared;
+}
+
+/* devices created later get the new transport, and so does the bus of the devices that already exist */
+void I2C_Bus::attach(uint8_t bus, std::shared_ptr<I2C_Transport> transport) {
+	std::lock_guard<std::mutex> guard(registry_lock);
+	if (transport) attached[bus] = transport;
+	else attached.erase(bus);
+
+	std::shared_ptr<I2C_Bus> shared = registry[bus].lock();
+	if (shared) shared->set_transport(transport);
+}
+
+uint8_t I2C_Bus::get_bus() {
+	return bus;
+}
+
+void I2C_Bus::set_transport(std::shared_ptr<I2C_Transport> transport) {
+	if (!transport) transport = std::make_shared<I2C_KernelTransport>(bus);
+
+	std::lock_guard<std::mutex> guard(lock);
+	this->transport = transport;
+}
+
+int I2C_Bus::perform(struct i2c_rdwr_ioctl_data* rdwr, uint64_t wait) {
+	uint64_t retries = transport->get_retries();
+	uint64_t start = monotonic_ns();
+	int status = transport->transfer(rdwr);
+	uint64_t end = monotonic_ns();
+	if (rdwr->nmsgs == 0) return status;
+
+	int error = errno;
+	uint8_t address = rdwr->msgs[0].addr & 0x7F;
+	I2C_Metrics* device = metrics[address].load(std::memory_order_relaxed);
+	if (device == NULL) {
+		device = new I2C_Metrics(bus, address);
+		metrics[address].store(device, std::memory_order_release);
+	}
+
+	uint32_t bytes = 0;
+	for (uint32_t i = 0; i < rdwr->nmsgs; i++) bytes += rdwr->msgs[i].len;
+	device->record(wait, end - start, bytes, status < 0, transport->get_retries() - retries);
+	TRACE_BUS("bus %u addr 0x%02x: %u msgs, %u bytes -> %d (%llu ns)", bus, address, rdwr->nmsgs, bytes, status,
+	          (unsigned long long)(end - start));
+	errno = error;
+
+	return status;
+}
+
+/* an uncontended bus costs no clock read for the wait, it is 0 */
+uint64_t I2C_Bus::acquire() {
+	if (lock.try_lock()) return 0;
+
+	uint64_t requested = monotonic_ns();
+	lock.lock();
+	return monotonic_ns() - requested;
+}
+
+int I2C_Bus::transfer(struct i2c_rdwr_ioctl_data* rdwr) {
+	uint64_t wait = acquire();
+	std::lock_guard<std::mutex> guard(lock, std::adopt_lock);
+	return perform(rdwr, wait);
+}
+
+int I2C_Bus::send_sequence(uint16_t* sequence, uint32_t sequence_length, uint8_t* received_data) {
+	uint64_t wait = acquire();
+	std::lock_guard<std::mutex> guard(lock, std::adopt_lock);
+	struct i2c_rdwr_ioctl_data rdwr;
+
+	if (sequence_length > I2C_MAX_SEQUENCE) return -1;
+	if (i2c_build_sequence(sequence, sequence_length, received_data, scratch, sizeof(scratch), &rdwr) < 0) return -1;
+
+	return perform(&rdwr, wait);
+}
+
+int I2C_Bus::get_metrics(uint8_t address, I2C_Metrics::snapshot_t& out) {
+	I2C_Metrics* device = metrics[address & 0x7F].load(std::memory_order_acquire);
+	if (device == NULL) return -1;
+
+	device->snapshot(out);
+	return 0;
+}
+
+void I2C_Bus::get_metrics(std::vector<I2C_Metrics::snapshot_t>& out) {
+	for (int address = 0; address < 128; address++) {
+		I2C_Metrics::snapshot_t snapshot;
+		if (get_metrics(address, snapshot) == 0) out.push_back(snapshot);
+	}
+}
+
+void I2C_Bus::get_all_metrics(std::vector<I2C_Metrics::snapshot_t>& out) {
+	/* collect the live buses first, snapshots are taken without holding the registry */
+	std::vector<std::shared_ptr<I2C_Bus>> buses;
+	{
+		std::lock_guard<std::mutex> guard(registry_lock);
+		for (auto& entry : registry) {
+			std::shared_ptr<I2C_Bus> shared = entry.second.lock();
+			if (shared) buses.push_back(shared);
+		}
+	}
+
+	for (auto& shared : buses) shared->get_metrics(out);
+}
+
+
+/************************** Functions **************************/
 
 I2C_Functions::I2C_Functions() {
 	I2CBus = 0;
@@ -19,7 +162,8 @@ I2C_Functions::I2C_Functions() {
 
 I2C_Functions::I2C_Functions(uint8_t bus, uint8_t device_addr, bool endianness) {
 	I2CBus = bus;
-	std::cout << "New Device Created! Device Address: " << std::hex << static_cast<int>(device_addr) << "\n" << std::endl;
+	this->bus = I2C_Bus::get(bus);
+	TRACE_INFO("new device 0x%02x on bus %u", device_addr, bus);
 	set_address(device_addr);
 	this->endianness = endianness;
 }
@@ -28,26 +172,30 @@ void I2C_Functions::set_address(uint8_t new_addr) {
 	I2CAddr_Write = (new_addr << 1) | 0;
 	I2CAddr_Read = (new_addr << 1) | 1;
 
-	if (new_addr != 0) {
-		std::cout << "Device Write Address: " << std::hex << static_cast<int>(I2CAddr_Write) << std::endl;
-		std::cout << "Device Read Address: " << std::hex << static_cast<int>(I2CAddr_Read) << std::endl;
-	}
+	if (new_addr != 0) TRACE_INFO("device address 0x%02x (write 0x%02x, read 0x%02x)", new_addr, I2CAddr_Write, I2CAddr_Read);
 }
 
 uint8_t I2C_Functions::get_address() {
 	return (I2CAddr_Write >> 1) & 0x7F;
 }
 
-int I2C_Functions::write(uint8_t reg, uint8_t data) {
-	int status; 
+std::shared_ptr<I2C_Bus> I2C_Functions::get_bus() {
+	return bus;
+}
 
-	uint16_t write_sequence[] = {I2CAddr_Write, reg, data};
+int I2C_Functions::get_metrics(I2C_Metrics::snapshot_t& out) {
+	if (!bus) return -1;
+	return bus->get_metrics(get_address(), out);
+}
 
-	int handle = i2c_open(I2CBus);
-	status = i2c_send_sequence(handle, write_sequence, 3, 0);
-	i2c_close(handle);
+int I2C_Functions::transfer(struct i2c_rdwr_ioctl_data* rdwr) {
+	if (!bus) return -1;		// default-constructed, no bus assigned
+	return bus->transfer(rdwr);
+}
 
-	return status;
+int I2C_Functions::write(uint8_t reg, uint8_t data) {
+	I2C_RegWrite<1> transaction(get_address(), reg, &data);
+	return transfer(&transaction.rdwr);
 }
 
 int I2C_Functions::write2(uint8_t reg, uint16_t data) {
@@ -68,43 +216,25 @@ int I2C_Functions::write2(uint8_t reg, uint16_t data) {
 }
 
 int I2C_Functions::writen(uint8_t reg, uint8_t* data, int n) {
-	int status; 
-
-	int m = 2;									// initial write sequence length
-	int write_seq_len = n+m;
-	uint16_t write_sequence[write_seq_len] = {I2CAddr_Write, reg};
-	int j = 0;									// data byte counter
-	for (int i = m; i < write_seq_len; i++) {
-		print_uint8("I2C", data[j]);
-		write_sequence[i] = data[j++];
-	}
+	if (n < 0 || n > I2C_MAX_WRITE) return -1;
 
-	int handle = i2c_open(I2CBus);
-	status = i2c_send_sequence(handle, write_sequence, write_seq_len, 0);
-	i2c_close(handle);
-
-	return status;
+	I2C_RegWrite<I2C_MAX_WRITE> transaction(get_address(), reg, data, n);
+	return transfer(&transaction.rdwr);
 }
 
 uint8_t I2C_Functions::read(uint8_t reg) {
-	print_uint8("Write Address", I2CAddr_Write);
-	uint16_t read_sequence[] = {I2CAddr_Write, reg, I2C_RESTART, I2CAddr_Read, I2C_READ};
-	uint8_t data_received[1] = {0};
-
-	int handle = i2c_open(I2CBus);
-	i2c_send_sequence(handle, read_sequence, 5, &data_received[0]);
-	i2c_close(handle);
+	I2C_RegRead<1> transaction(get_address(), reg);
+	transaction.data[0] = 0;
+	transfer(&transaction.rdwr);
 
-	return data_received[0];
+	return transaction.data[0];
 }
 
 uint16_t I2C_Functions::read2(uint8_t reg) {
-	uint16_t read_sequence[] = {I2CAddr_Write, reg, I2C_RESTART, I2CAddr_Read, I2C_READ, I2C_READ};
-	uint8_t data_received[2] = {0};
-
-	int handle = i2c_open(I2CBus);
-	i2c_send_sequence(handle, read_sequence, 6, &data_received[0]);
-	i2c_close(handle);
+	I2C_RegRead<2> transaction(get_address(), reg);
+	uint8_t* data_received = transaction.data;
+	data_received[0] = data_received[1] = 0;
+	transfer(&transaction.rdwr);
 
 	uint16_t data_read;
 	if (endianness == C_BIG_ENDIAN) data_read = (((uint16_t)data_received[0])<<8) | ((uint16_t)data_received[1]);
@@ -115,20 +245,108 @@ uint16_t I2C_Functions::read2(uint8_t reg) {
 
 uint8_t* I2C_Functions::readn(uint8_t reg, int n, uint8_t* data_received) {
 	/* requires {uint8_t data[n];} prior to call. the values are returned in the 'data' variable. */
-	int m = 4;					// initial read sequence length
-	int read_seq_len = m+n;
-	uint16_t read_sequence[read_seq_len] = {I2CAddr_Write, reg, I2C_RESTART, I2CAddr_Read};
-	for (int i = m; i < read_seq_len; i++) {
-		read_sequence[i] = I2C_READ;
-	}
+	if (n < 0 || n > UINT16_MAX) return NULL;
 
-	int handle = i2c_open(I2CBus);
-	i2c_send_sequence(handle, read_sequence, read_seq_len, &data_received[0]);
-	i2c_close(handle);
+	I2C_RegReadInto transaction(get_address(), reg, data_received, n);
+	if (transfer(&transaction.rdwr) < 0) return NULL;
 
 	return data_received;
 }
 
+/************************** I2C Queue **************************/
+
+I2C_Queue::I2C_Queue() {
+	clear();
+}
+
+void I2C_Queue::clear() {
+	bus.reset();
+	nmsgs = nops = txLen = 0;
+}
+
+int I2C_Queue::size() {
+	return nops;
+}
+
+int I2C_Queue::add(I2C_Functions& dev, int msgs_needed, int tx_needed) {
+	std::shared_ptr<I2C_Bus> dev_bus = dev.get_bus();
+	if (!dev_bus) return -1;
+	if (bus && bus != dev_bus) return -1;			// all operations must share one bus (and thus one ioctl)
+	if (nmsgs + msgs_needed > I2C_RDRW_IOCTL_MAX_MSGS || txLen + tx_needed > I2C_QUEUE_TX_SIZE) return -1;
+
+	bus = dev_bus;
+	return nops;
+}
+
+int I2C_Queue::add_write(I2C_Functions& dev, uint8_t reg, const uint8_t* data, int n) {
+	if (n < 0) return -1;
+	int op = add(dev, 1, n + 1);
+	if (op < 0) return -1;
+
+	uint8_t* buf = &tx[txLen];
+	buf[0] = reg;
+	memcpy(&buf[1], data, n);
+	txLen += n + 1;
+
+	msgs[nmsgs].addr = dev.get_address();
+	msgs[nmsgs].flags = 0;
+	msgs[nmsgs].len = n + 1;
+	msgs[nmsgs].buf = buf;
+	nmsgs++;
+
+	opEnd[nops++] = nmsgs;
+	return op;
+}
+
+int I2C_Queue::add_read(I2C_Functions& dev, uint8_t reg, uint8_t* data_received, int n) {
+	if (n < 0 || n > UINT16_MAX) return -1;
+	int op = add(dev, 2, 1);
+	if (op < 0) return -1;
+
+	uint8_t* buf = &tx[txLen];
+	buf[0] = reg;
+	txLen += 1;
+
+	msgs[nmsgs].addr = dev.get_address();
+	msgs[nmsgs].flags = 0;
+	msgs[nmsgs].len = 1;
+	msgs[nmsgs].buf = buf;
+	msgs[nmsgs + 1].addr = dev.get_address();
+	msgs[nmsgs + 1].flags = I2C_M_RD;
+	msgs[nmsgs + 1].len = n;
+	msgs[nmsgs + 1].buf = data_received;
+	nmsgs += 2;
+
+	opEnd[nops++] = nmsgs;
+	return op;
+}
+
+int I2C_Queue::submit() {
+	if (nops == 0) return 0;
+
+	struct i2c_rdwr_ioctl_data rdwr;
+	rdwr.msgs = msgs;
+	rdwr.nmsgs = nmsgs;
+	int status = bus->transfer(&rdwr);
+	int error = (status < 0) ? -errno : -EIO;
+
+	/* the adapter reports how many messages went through; operations past that point failed */
+	int completed = 0;
+	for (int op = 0; op < nops; op++) {
+		bool done = status >= 0 && opEnd[op] <= status;
+		results[op] = done ? 0 : error;
+		if (done) completed++;
+	}
+
+	return (status < 0) ? -1 : completed;
+}
+
+int I2C_Queue::result(int op) {
+	if (op < 0 || op >= nops) return -EINVAL;
+	return results[op];
+}
+
+
 /********************* Visualize *******************/
 
 void I2C_Functions::print_uint8(std::string descriptor, uint8_t data) {
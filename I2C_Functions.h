@@ -24,7 +24,14 @@
 #include <iostream>
 #include <stdlib.h>
 #include <stdint.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "lsquaredc.h"
+#include "I2C_Transaction.h"
+#include "I2C_Transport.h"
+#include "I2C_Metrics.h"
 
 
 /*************************** Defines ***************************/
@@ -37,6 +44,50 @@
 #define C_BIG_ENDIAN		0
 #define C_LITTLE_ENDIAN		1
 
+#define I2C_MAX_SEQUENCE	512 		// longest lsquaredc sequence accepted by I2C_Bus::send_sequence()
+#define I2C_QUEUE_TX_SIZE	256 		// bytes of register addresses and write data one I2C_Queue can hold
+
+
+/*************************** I2C Bus ***************************/
+
+/*
+ * One I2C bus, shared by every device on it. Transactions are serialized here and carried out by a transport: the
+ * kernel's /dev/i2c-N by default (see I2C_KernelTransport, which keeps the handle open so a transaction costs a single
+ * ioctl), or any other backend routed to the bus number with attach(), e.g. a sensor on SPI (I2C_SPITransport) or the
+ * simulated sensor of SimICM20948.h.
+ * Use I2C_Bus::get() to obtain the instance shared by every device on the same bus; it is released once the last user
+ * drops it. Every transaction is accounted to the device it addresses (see I2C_Metrics.h).
+ */
+class I2C_Bus {
+private:
+	uint8_t bus;
+	std::shared_ptr<I2C_Transport> transport;				// guarded by 'lock'
+	std::mutex lock;										// serializes transactions and transport changes
+	uint64_t scratch[(I2C_SCRATCH_SIZE(I2C_MAX_SEQUENCE) + 7) / 8];	// message arena, guarded by 'lock'
+	std::atomic<I2C_Metrics*> metrics[128];					// per 7-bit address, created on first use
+
+	uint64_t acquire();										// takes 'lock', returns how long that took [ns]
+	int perform(struct i2c_rdwr_ioctl_data* rdwr, uint64_t wait);	// timed transfer, requires 'lock'
+
+public:
+	explicit I2C_Bus(uint8_t bus, std::shared_ptr<I2C_Transport> transport = nullptr);	// nullptr selects /dev/i2c-N
+	~I2C_Bus();
+	I2C_Bus(const I2C_Bus&) = delete;
+	I2C_Bus& operator=(const I2C_Bus&) = delete;
+
+	static std::shared_ptr<I2C_Bus> get(uint8_t bus);		// fetches the shared handle for a bus number
+	static void attach(uint8_t bus, std::shared_ptr<I2C_Transport> transport);	// reroutes a bus number, nullptr restores /dev/i2c-N
+	uint8_t get_bus();
+	void set_transport(std::shared_ptr<I2C_Transport> transport);
+
+	int transfer(struct i2c_rdwr_ioctl_data* rdwr);			// performs a prebuilt transaction (I2C_Transaction.h)
+	int send_sequence(uint16_t* sequence, uint32_t sequence_length, uint8_t* received_data);	// lsquaredc sequence
+
+	int get_metrics(uint8_t address, I2C_Metrics::snapshot_t& out);		// -1 if the device was never addressed
+	void get_metrics(std::vector<I2C_Metrics::snapshot_t>& out);			// appends every device of this bus
+	static void get_all_metrics(std::vector<I2C_Metrics::snapshot_t>& out);	// appends every device of every bus
+};
+
 
 /************************** Functions **************************/
 
@@ -44,22 +95,59 @@ class I2C_Functions {
 private:
 	uint8_t I2CBus, I2CAddr_Write, I2CAddr_Read;
 	bool endianness;
+	std::shared_ptr<I2C_Bus> bus;							// shared with all devices on I2CBus
+
+	int transfer(struct i2c_rdwr_ioctl_data* rdwr);
 
 public:  
 	I2C_Functions();
 	I2C_Functions(uint8_t bus, uint8_t device_addr, bool endianness = C_BIG_ENDIAN);
 	void set_address(uint8_t new_addr);							// sets the device address
 	uint8_t get_address();										// fetches the device address
+	std::shared_ptr<I2C_Bus> get_bus();							// fetches the shared bus handle
+	int get_metrics(I2C_Metrics::snapshot_t& out);				// this device's counters, -1 if it has none yet
 
 	int write(uint8_t reg, uint8_t data);						// writes 1 byte of data into register
 	int write2(uint8_t reg, uint16_t data);						// writes 2 bytes of data into consecutive registers
-	int writen(uint8_t reg, uint8_t* data, int n);				// wrotes n bytes of data into conecutive register
+	int writen(uint8_t reg, uint8_t* data, int n);				// wrotes n bytes of data into conecutive register (n <= I2C_MAX_WRITE)
 	uint8_t read(uint8_t reg);									// reads 1 byte of data from register
 	uint16_t read2(uint8_t reg);								// reads 2 bytes of data from consecutive registers
-	uint8_t* readn(uint8_t reg, int n, uint8_t* data_received);	// reads n bytes of data from consecutive registers (requires memory preallocation)
+	uint8_t* readn(uint8_t reg, int n, uint8_t* data_received);	// reads n bytes of data from consecutive registers (requires memory preallocation), NULL on error
 	
 	void print_uint8(std::string descriptor, uint8_t data);
 	void print_uint16(std::string descriptor, uint16_t data);
 };
 
+
+/*************************** I2C Queue **************************/
+
+/*
+ * Collects register reads and writes, possibly for different devices on the same bus, and submits them as a single
+ * I2C_RDWR ioctl (one START, repeated starts in between, one STOP). A read takes two of the I2C_RDRW_IOCTL_MAX_MSGS
+ * messages, a write takes one. Read buffers must stay valid until submit() returns.
+ */
+class I2C_Queue {
+private:
+	std::shared_ptr<I2C_Bus> bus;
+	struct i2c_msg msgs[I2C_RDRW_IOCTL_MAX_MSGS];
+	uint8_t opEnd[I2C_RDRW_IOCTL_MAX_MSGS];					// index one past the last message of each operation
+	int results[I2C_RDRW_IOCTL_MAX_MSGS];
+	uint8_t tx[I2C_QUEUE_TX_SIZE];
+	int nmsgs, nops, txLen;
+
+	int add(I2C_Functions& dev, int nmsgs, int txLen);		// checks capacity and bus, returns the operation index
+
+public:
+	I2C_Queue();
+	I2C_Queue(const I2C_Queue&) = delete;
+	I2C_Queue& operator=(const I2C_Queue&) = delete;
+
+	int add_write(I2C_Functions& dev, uint8_t reg, const uint8_t* data, int n);		// returns the operation index, -1 if it does not fit
+	int add_read(I2C_Functions& dev, uint8_t reg, uint8_t* data_received, int n);		// returns the operation index, -1 if it does not fit
+	int submit();												// returns the number of operations that completed, -1 on error
+	int result(int op);											// 0 if the operation completed, otherwise a negative errno
+	int size();													// number of queued operations
+	void clear();
+};
+
 #endif // I2C_FUNCTIONS
\ No newline at end of file
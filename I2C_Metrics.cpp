@@ -0,0 +1,195 @@
+/****************************************************************************
+ * I2C_Metrics.cpp
+ *
+ * @about      : Always-on per-device transaction counters and latency
+ *               histograms for the I2C buses.
+ * @author     : Carlos Carrasquillo
+ * @contact    : c.carrasquillo@ufl.edu
+ * @date       : October 18, 2026
+ * @modified   : October 18, 2026
+ *
+ * Property of ADAMUS lab, University of Florida.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "I2C_Functions.h"
+#include "I2C_Metrics.h"
+
+/*************************** Metrics ***************************/
+
+I2C_Metrics::I2C_Metrics(uint8_t bus, uint8_t address) : transactions(0), bytes(0), errors(0), retries(0), latency(0),
+                                                         maxLatency(0), wait(0), maxWait(0) {
+	this->bus = bus;
+	this->address = address;
+	for (int i = 0; i < I2C_METRICS_BUCKETS; i++) buckets[i].store(0, std::memory_order_relaxed);
+}
+
+/* the first buckets hold 0..3 ns exactly, after that each power of two is split into I2C_METRICS_SUB_BUCKETS */
+int I2C_Metrics::bucket_of(uint64_t ns) {
+	if (ns < I2C_METRICS_SUB_BUCKETS) return ns;
+
+	int msb = 63 - __builtin_clzll(ns);
+	int bucket = (msb - 1) * I2C_METRICS_SUB_BUCKETS + ((ns >> (msb - 2)) & (I2C_METRICS_SUB_BUCKETS - 1));
+	return (bucket < I2C_METRICS_BUCKETS) ? bucket : I2C_METRICS_BUCKETS - 1;
+}
+
+uint64_t I2C_Metrics::bucket_limit(int bucket) {
+	if (bucket < I2C_METRICS_SUB_BUCKETS) return bucket;
+
+	int msb = bucket / I2C_METRICS_SUB_BUCKETS + 1;
+	uint64_t step = 1ULL << (msb - 2);
+	return (I2C_METRICS_SUB_BUCKETS + bucket % I2C_METRICS_SUB_BUCKETS + 1) * step - 1;
+}
+
+void I2C_Metrics::record(uint64_t wait_ns, uint64_t latency_ns, uint32_t bytes, bool error, uint64_t retries) {
+	add(transactions, 1);
+	add(this->bytes, bytes);
+	if (error) add(errors, 1);
+	if (retries) add(this->retries, retries);
+	add(latency, latency_ns);
+	add(wait, wait_ns);
+	if (latency_ns > maxLatency.load(std::memory_order_relaxed)) maxLatency.store(latency_ns, std::memory_order_relaxed);
+	if (wait_ns > maxWait.load(std::memory_order_relaxed)) maxWait.store(wait_ns, std::memory_order_relaxed);
+	add(buckets[bucket_of(latency_ns)], 1);
+}
+
+void I2C_Metrics::snapshot(snapshot_t& out) {
+	out.bus = bus;
+	out.address = address;
+	out.transactions = transactions.load(std::memory_order_relaxed);
+	out.bytes = bytes.load(std::memory_order_relaxed);
+	out.errors = errors.load(std::memory_order_relaxed);
+	out.retries = retries.load(std::memory_order_relaxed);
+	out.latency_ns = latency.load(std::memory_order_relaxed);
+	out.max_ns = maxLatency.load(std::memory_order_relaxed);
+	out.wait_ns = wait.load(std::memory_order_relaxed);
+	out.max_wait_ns = maxWait.load(std::memory_order_relaxed);
+	for (int i = 0; i < I2C_METRICS_BUCKETS; i++) out.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+}
+
+uint64_t I2C_Metrics::snapshot_t::percentile(double p) const {
+	uint64_t total = 0;
+	for (int i = 0; i < I2C_METRICS_BUCKETS; i++) total += buckets[i];
+	if (total == 0) return 0;
+
+	/* the histogram is read after the counters, so it may hold a few more transactions than 'transactions' */
+	uint64_t rank = (uint64_t)(p * total);
+	if (rank >= total) rank = total - 1;
+	uint64_t seen = 0;
+	for (int i = 0; i < I2C_METRICS_BUCKETS; i++) {
+		seen += buckets[i];
+		if (seen > rank) {
+			uint64_t limit = bucket_limit(i);
+			return (limit < max_ns) ? limit : max_ns;
+		}
+	}
+
+	return max_ns;
+}
+
+
+/**************************** Export ***************************/
+
+void i2c_metrics_snapshot(std::vector<I2C_Metrics::snapshot_t>& out) {
+	out.clear();
+	I2C_Bus::get_all_metrics(out);
+}
+
+static void write_counter(FILE* file, const char* name, const char* help, const char* type,
+                          const std::vector<I2C_Metrics::snapshot_t>& devices, double (*value)(const I2C_Metrics::snapshot_t&)) {
+	fprintf(file, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+	for (const I2C_Metrics::snapshot_t& d : devices) {
+		fprintf(file, "%s{bus=\"%d\",address=\"0x%02x\"} %.9g\n", name, d.bus, d.address, value(d));
+	}
+}
+
+int i2c_metrics_write(const std::string& path) {
+	std::vector<I2C_Metrics::snapshot_t> devices;
+	i2c_metrics_snapshot(devices);
+
+	std::string tmp = path + ".tmp";
+	FILE* file = fopen(tmp.c_str(), "w");
+	if (file == NULL) return -1;
+
+	write_counter(file, "i2c_transactions_total", "I2C transactions.", "counter", devices,
+	              [](const I2C_Metrics::snapshot_t& d) { return (double)d.transactions; });
+	write_counter(file, "i2c_bytes_total", "Bytes transferred, register addresses included.", "counter", devices,
+	              [](const I2C_Metrics::snapshot_t& d) { return (double)d.bytes; });
+	write_counter(file, "i2c_errors_total", "Failed transactions.", "counter", devices,
+	              [](const I2C_Metrics::snapshot_t& d) { return (double)d.errors; });
+	write_counter(file, "i2c_retries_total", "Transport retries after the adapter went away.", "counter", devices,
+	              [](const I2C_Metrics::snapshot_t& d) { return (double)d.retries; });
+	write_counter(file, "i2c_lock_wait_seconds_total", "Time spent waiting for the bus behind other threads.", "counter",
+	              devices, [](const I2C_Metrics::snapshot_t& d) { return d.wait_ns * 1e-9; });
+	write_counter(file, "i2c_lock_wait_max_seconds", "Longest wait for the bus.", "gauge", devices,
+	              [](const I2C_Metrics::snapshot_t& d) { return d.max_wait_ns * 1e-9; });
+	write_counter(file, "i2c_latency_max_seconds", "Slowest transaction.", "gauge", devices,
+	              [](const I2C_Metrics::snapshot_t& d) { return d.max_ns * 1e-9; });
+
+	fprintf(file, "# HELP i2c_latency_seconds Time spent in the transport per transaction.\n");
+	fprintf(file, "# TYPE i2c_latency_seconds summary\n");
+	for (const I2C_Metrics::snapshot_t& d : devices) {
+		const double quantiles[] = {0.5, 0.9, 0.99};
+		for (double q : quantiles) {
+			fprintf(file, "i2c_latency_seconds{bus=\"%d\",address=\"0x%02x\",quantile=\"%g\"} %.9g\n", d.bus, d.address,
+			        q, d.percentile(q) * 1e-9);
+		}
+		fprintf(file, "i2c_latency_seconds_sum{bus=\"%d\",address=\"0x%02x\"} %.9g\n", d.bus, d.address, d.latency_ns * 1e-9);
+		fprintf(file, "i2c_latency_seconds_count{bus=\"%d\",address=\"0x%02x\"} %llu\n", d.bus, d.address,
+		        (unsigned long long)d.transactions);
+	}
+
+	bool failed = ferror(file);
+	if (fclose(file) != 0 || failed || rename(tmp.c_str(), path.c_str()) != 0) {
+		remove(tmp.c_str());
+		return -1;
+	}
+
+	return 0;
+}
+
+I2C_MetricsExporter::I2C_MetricsExporter() {
+	periodMs = 0;
+	stopping = false;
+}
+
+I2C_MetricsExporter::~I2C_MetricsExporter() {
+	stop();
+}
+
+int I2C_MetricsExporter::start(const std::string& path, int period_ms) {
+	if (worker.joinable() || period_ms <= 0) return -1;
+
+	this->path = path;
+	periodMs = period_ms;
+	stopping = false;
+	worker = std::thread(&I2C_MetricsExporter::exportLoop, this);
+
+	return 0;
+}
+
+void I2C_MetricsExporter::stop() {
+	if (!worker.joinable()) return;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	worker.join();
+}
+
+void I2C_MetricsExporter::exportLoop() {
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		bool stopped = wake.wait_for(guard, std::chrono::milliseconds(periodMs), [this] { return stopping; });
+
+		guard.unlock();
+		i2c_metrics_write(path);
+		guard.lock();
+
+		if (stopped) break;
+	}
+}
@@ -0,0 +1,119 @@
+/****************************************************************************
+* I2C_Metrics.h
+*
+* @about      : Always-on per-device transaction counters and latency
+*               histograms for the I2C buses.
+* @author     : Carlos Carrasquillo
+* @contact    : c.carrasquillo@ufl.edu
+* @date       : October 18, 2026
+* @modified   : October 18, 2026
+*
+* Property of ADAMUS lab, University of Florida.
+****************************************************************************/
+
+#ifndef I2C_METRICS
+#define I2C_METRICS
+
+
+/************************** Includes **************************/
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/*************************** Defines ***************************/
+
+#define I2C_METRICS_SUB_BUCKETS	4		// histogram buckets per power of two (~19% resolution), fixed by bucket_of()
+#define I2C_METRICS_BUCKETS		(36 * I2C_METRICS_SUB_BUCKETS)	// up to 2^36 ns (~69 s), longer ones land in the last
+
+
+/************************** Metrics ***************************/
+
+/*
+ * The counters of one device (bus + address). A transaction is counted when it leaves I2C_Bus: its latency is the
+ * time spent in the transport (the adapter, the kernel and the wire) and its wait the time spent queueing for the bus
+ * lock behind other threads, so a slow loop can be blamed on the bus, the kernel or the host. A batch that addresses
+ * several devices (I2C_Queue) is counted against the device of its first message.
+ *
+ * Updates happen under the bus lock, so there is a single writer and each field is a plain load and store; readers
+ * never take the lock and see every field whole, though not necessarily all of them from the same instant. The cost
+ * is two vDSO clock reads and a few stores per transaction.
+ */
+class I2C_Metrics {
+public:
+	struct snapshot_t {
+		uint8_t bus, address;
+		uint64_t transactions;
+		uint64_t bytes;						// payload bytes of every message, register addresses included
+		uint64_t errors;					// transactions that returned -1
+		uint64_t retries;					// transport-level retries, e.g. reconnects after ENODEV
+		uint64_t latency_ns;				// sum over all transactions
+		uint64_t max_ns;
+		uint64_t wait_ns;					// sum of the time spent waiting for the bus lock
+		uint64_t max_wait_ns;
+		uint64_t buckets[I2C_METRICS_BUCKETS];
+
+		uint64_t percentile(double p) const;	// [ns] upper bound of the bucket holding quantile p (0..1)
+	};
+
+private:
+	uint8_t bus, address;
+	std::atomic<uint64_t> transactions, bytes, errors, retries, latency, maxLatency, wait, maxWait;
+	std::atomic<uint64_t> buckets[I2C_METRICS_BUCKETS];
+
+	static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+public:
+	I2C_Metrics(uint8_t bus, uint8_t address);
+	I2C_Metrics(const I2C_Metrics&) = delete;
+	I2C_Metrics& operator=(const I2C_Metrics&) = delete;
+
+	static int bucket_of(uint64_t ns);
+	static uint64_t bucket_limit(int bucket);	// [ns] largest value of a bucket
+
+	void record(uint64_t wait_ns, uint64_t latency_ns, uint32_t bytes, bool error, uint64_t retries);	// bus lock held
+	void snapshot(snapshot_t& out);
+};
+
+
+/*************************** Export ****************************/
+
+/* every device seen on every bus in use, see I2C_Bus::get_metrics() */
+void i2c_metrics_snapshot(std::vector<I2C_Metrics::snapshot_t>& out);
+
+/* Prometheus text exposition format, written to 'path' through a temporary file and a rename (never half written) */
+int i2c_metrics_write(const std::string& path);
+
+/*
+ * Rewrites the metrics file every 'period_ms' from a background thread, e.g. into node_exporter's textfile collector
+ * directory. The file is also written once more on stop().
+ */
+class I2C_MetricsExporter {
+private:
+	std::string path;
+	int periodMs;
+	bool stopping;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::thread worker;
+
+	void exportLoop();
+
+public:
+	I2C_MetricsExporter();
+	~I2C_MetricsExporter();
+	I2C_MetricsExporter(const I2C_MetricsExporter&) = delete;
+	I2C_MetricsExporter& operator=(const I2C_MetricsExporter&) = delete;
+
+	int start(const std::string& path, int period_ms = 10000);	// -1 if already running
+	void stop();
+};
+
+#endif // I2C_METRICS
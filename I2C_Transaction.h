@@ -0,0 +1,98 @@
+/****************************************************************************
+* I2C_Transaction.h
+*
+* @about      : Prebuilt I2C_RDWR transactions for register-level access.
+* @author     : Carlos Carrasquillo
+* @contact    : c.carrasquillo@ufl.edu
+* @date       : October 18, 2026
+* @modified   : October 18, 2026
+*
+* Property of ADAMUS lab, University of Florida.
+****************************************************************************/
+
+#ifndef I2C_TRANSACTION
+#define I2C_TRANSACTION
+
+
+/************************** Includes **************************/
+
+#include <stdint.h>
+#include <string.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+
+/*************************** Defines ***************************/
+
+#define I2C_MAX_WRITE		255 		// largest payload of a single register write (see I2C_Functions::writen)
+
+
+/************************ Transactions *************************/
+
+/*
+ * Each transaction type below has a fixed shape known at compile time: the number of messages, their direction and
+ * (for the templates) their lengths. The struct i2c_msg array and the i2c_rdwr_ioctl_data descriptor are laid out
+ * directly in the object by the constructor, so performing the transaction is a single ioctl(I2C_RDWR) on
+ * 'rdwr' -- no lsquaredc sequence is built or parsed at runtime. The descriptors point into the object itself,
+ * which is why copying is disabled.
+ *
+ * All addresses are 7-bit Linux addresses, i.e. I2C_Functions::get_address().
+ */
+
+/* write the register address, repeated start, read 'len' bytes into a caller-provided buffer */
+class I2C_RegReadInto {
+public:
+	uint8_t reg;
+	struct i2c_msg msgs[2];
+	struct i2c_rdwr_ioctl_data rdwr;
+
+	I2C_RegReadInto(uint8_t addr, uint8_t reg, uint8_t* buf, uint16_t len) : reg(reg) {
+		msgs[0].addr = addr;
+		msgs[0].flags = 0;
+		msgs[0].len = 1;
+		msgs[0].buf = &this->reg;
+		msgs[1].addr = addr;
+		msgs[1].flags = I2C_M_RD;
+		msgs[1].len = len;
+		msgs[1].buf = buf;
+		rdwr.msgs = msgs;
+		rdwr.nmsgs = 2;
+	}
+
+	I2C_RegReadInto(const I2C_RegReadInto&) = delete;
+	I2C_RegReadInto& operator=(const I2C_RegReadInto&) = delete;
+};
+
+/* write the register address, repeated start, read N bytes into 'data' */
+template <uint16_t N>
+class I2C_RegRead : public I2C_RegReadInto {
+public:
+	uint8_t data[N];
+
+	I2C_RegRead(uint8_t addr, uint8_t reg) : I2C_RegReadInto(addr, reg, data, N) {}
+};
+
+/* write the register address followed by up to N data bytes (auto-incrementing registers) */
+template <uint16_t N>
+class I2C_RegWrite {
+public:
+	uint8_t buf[N + 1];
+	struct i2c_msg msgs[1];
+	struct i2c_rdwr_ioctl_data rdwr;
+
+	I2C_RegWrite(uint8_t addr, uint8_t reg, const uint8_t* data, uint16_t len = N) {
+		buf[0] = reg;
+		memcpy(&buf[1], data, len);
+		msgs[0].addr = addr;
+		msgs[0].flags = 0;
+		msgs[0].len = len + 1;
+		msgs[0].buf = buf;
+		rdwr.msgs = msgs;
+		rdwr.nmsgs = 1;
+	}
+
+	I2C_RegWrite(const I2C_RegWrite&) = delete;
+	I2C_RegWrite& operator=(const I2C_RegWrite&) = delete;
+};
+
+#endif // I2C_TRANSACTION
@@ -0,0 +1,214 @@
+/****************************************************************************
+ * I2C_Transport.cpp
+ *
+ * @about      : The backends that carry I2C_RDWR transactions for I2C_Bus.
+ * @author     : Carlos Carrasquillo
+ * @contact    : c.carrasquillo@ufl.edu
+ * @date       : October 18, 2026
+ * @modified   : October 18, 2026
+ *
+ * Property of ADAMUS lab, University of Florida.
+ ****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "I2C_Transport.h"
+
+/*********************** Kernel Transport **********************/
+
+I2C_KernelTransport::I2C_KernelTransport(uint8_t bus) {
+	this->bus = bus;
+	handle = -1;
+	retries = 0;
+}
+
+I2C_KernelTransport::~I2C_KernelTransport() {
+	disconnect();
+}
+
+int I2C_KernelTransport::connect() {
+	disconnect();
+	handle = i2c_open(bus);
+	return handle;
+}
+
+void I2C_KernelTransport::disconnect() {
+	if (handle >= 0) i2c_close(handle);
+	handle = -1;
+}
+
+int I2C_KernelTransport::transfer(struct i2c_rdwr_ioctl_data* rdwr) {
+	/* the handle is opened on first use and then stays open, so a transaction costs a single ioctl */
+	if (handle < 0 && connect() < 0) return -1;
+	int status = ioctl(handle, I2C_RDWR, rdwr);
+
+	/*
+	 * the adapter was removed or reset underneath us: reopen the bus and retry once. ENODEV means nothing reached the
+	 * wire; EIO is not retried since it usually follows a NACK or lost arbitration part way through, and replaying
+	 * would repeat accesses that are not idempotent (FIFO_R_W pops, clear-on-read status registers).
+	 */
+	if (status < 0 && errno == ENODEV) {
+		retries++;
+		if (connect() < 0) return -1;
+		status = ioctl(handle, I2C_RDWR, rdwr);
+	}
+
+	return status;
+}
+
+
+/************************ SPI Transport ************************/
+
+I2C_SPITransport::I2C_SPITransport(const std::string& device, uint8_t address, uint32_t speed_hz, uint32_t burst_hz,
+                                   uint8_t mode) {
+	this->device = device;
+	this->address = address;
+	speedHz = speed_hz;
+	burstHz = burst_hz;
+	this->mode = mode;
+	handle = -1;
+	bank = I2C_SPI_BANK_UNKNOWN;
+	spiOnly = false;
+}
+
+I2C_SPITransport::~I2C_SPITransport() {
+	disconnect();
+}
+
+int I2C_SPITransport::connect() {
+	disconnect();
+	handle = open(device.c_str(), O_RDWR | O_CLOEXEC);
+	if (handle < 0) return -1;
+
+	uint8_t bits = 8;
+	uint32_t maxSpeed = (burstHz > speedHz) ? burstHz : speedHz;
+	if (ioctl(handle, SPI_IOC_WR_MODE, &mode) < 0 || ioctl(handle, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+	    ioctl(handle, SPI_IOC_WR_MAX_SPEED_HZ, &maxSpeed) < 0) {
+		int error = errno;
+		disconnect();
+		errno = error;
+		return -1;
+	}
+
+	return handle;
+}
+
+void I2C_SPITransport::disconnect() {
+	if (handle >= 0) close(handle);
+	handle = -1;
+}
+
+int I2C_SPITransport::exchange(struct spi_ioc_transfer* xfers, uint32_t count) {
+	if (handle < 0 && connect() < 0) return -1;
+	/* SPI_IOC_MESSAGE(count) with a count only known at run time */
+	return ioctl(handle, _IOC(_IOC_WRITE, SPI_IOC_MAGIC, 0, count * sizeof(struct spi_ioc_transfer)), xfers);
+}
+
+bool I2C_SPITransport::burstRegister(uint8_t bank, uint8_t reg) {
+	if (bank != 0) return false;
+	return (reg >= I2C_SPI_DATA_FIRST && reg <= I2C_SPI_DATA_LAST) || reg == I2C_SPI_FIFO_R_W ||
+	       (reg >= I2C_SPI_INT_FIRST && reg <= I2C_SPI_INT_LAST);
+}
+
+int I2C_SPITransport::frame(uint8_t reg, uint8_t* data, uint32_t len, bool read) {
+	struct spi_ioc_transfer frame[2];
+	memset(frame, 0, sizeof(frame));
+	uint8_t header = read ? (reg | I2C_SPI_READ_BM) : reg;
+	frame[0].tx_buf = (uintptr_t)&header;
+	frame[0].len = 1;
+	frame[1].len = len;
+	if (read) frame[1].rx_buf = (uintptr_t)data;
+	else frame[1].tx_buf = (uintptr_t)data;
+	for (int i = 0; i < 2; i++) {
+		frame[i].speed_hz = speedHz;
+		frame[i].bits_per_word = 8;
+	}
+
+	return exchange(frame, 2);
+}
+
+/* USER_CTRL is in bank 0; the bank that was selected before is restored, so the driver's shadow of it stays right */
+int I2C_SPITransport::disableI2C() {
+	uint8_t previous = bank;
+	uint8_t value = 0;
+	bank = I2C_SPI_BANK_UNKNOWN;
+	if (frame(I2C_SPI_BANK_SEL, &value, 1, false) < 0 || frame(I2C_SPI_USER_CTRL, &value, 1, true) < 0) return -1;
+	value |= I2C_SPI_IF_DIS_BM;
+	if (frame(I2C_SPI_USER_CTRL, &value, 1, false) < 0) return -1;
+	bank = 0;
+
+	if (previous != I2C_SPI_BANK_UNKNOWN && previous != 0) {
+		if (frame(I2C_SPI_BANK_SEL, &previous, 1, false) < 0) return -1;
+		bank = previous;
+	}
+	spiOnly = true;
+
+	return 0;
+}
+
+int I2C_SPITransport::transfer(struct i2c_rdwr_ioctl_data* rdwr) {
+	if (rdwr->nmsgs == 0) return 0;
+	if (rdwr->nmsgs > I2C_RDWR_IOCTL_MAX_MSGS) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (!spiOnly && disableI2C() < 0) return -1;
+
+	/* the bank each frame runs in, as selected by the frames before it */
+	uint8_t pending = bank;
+	bool reset = false;
+	uint32_t count = 0;
+	memset(xfers, 0, rdwr->nmsgs * sizeof(struct spi_ioc_transfer));
+	for (uint32_t i = 0; i < rdwr->nmsgs; i++) {
+		struct i2c_msg& msg = rdwr->msgs[i];
+		bool read = (i + 1 < rdwr->nmsgs) && (rdwr->msgs[i + 1].flags & I2C_M_RD);
+		if (msg.addr != address || (read && rdwr->msgs[i + 1].addr != address)) {
+			errno = ENXIO;
+			return -1;
+		}
+		if ((msg.flags & I2C_M_RD) || msg.len == 0 || (msg.buf[0] & I2C_SPI_READ_BM) || (read && msg.len != 1)) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		if (read) {
+			/* [reg | 0x80] and the data clocked back, one frame: the chip select stays down between the two */
+			struct i2c_msg& data = rdwr->msgs[++i];
+			headers[count] = msg.buf[0] | I2C_SPI_READ_BM;
+			xfers[count].tx_buf = (uintptr_t)&headers[count];
+			xfers[count].len = 1;
+			xfers[count].speed_hz = burstRegister(pending, msg.buf[0]) ? burstHz : speedHz;
+			xfers[count].bits_per_word = 8;
+			count++;
+			xfers[count].rx_buf = (uintptr_t)data.buf;
+			xfers[count].len = data.len;
+			xfers[count].speed_hz = xfers[count - 1].speed_hz;
+		} else {
+			/* [reg, data...], the register byte already has the write bit clear */
+			xfers[count].tx_buf = (uintptr_t)msg.buf;
+			xfers[count].len = msg.len;
+			xfers[count].speed_hz = speedHz;
+			if (msg.len > 1 && msg.buf[0] == I2C_SPI_BANK_SEL) {
+				pending = msg.buf[1] & (3 << 4);
+			} else if (msg.len > 1 && msg.buf[0] == I2C_SPI_PWR_MGMT_1 && pending == 0 && (msg.buf[1] & I2C_SPI_RESET_BM)) {
+				reset = true;
+			}
+		}
+		xfers[count].bits_per_word = 8;
+		xfers[count].cs_change = 1;					// end of frame
+		count++;
+	}
+	xfers[count - 1].cs_change = 0;					// on the last transfer it would keep the chip selected instead
+
+	if (exchange(xfers, count) < 0) {
+		bank = I2C_SPI_BANK_UNKNOWN;				// the bank select may or may not have gone through
+		return -1;
+	}
+	bank = reset ? 0 : pending;
+	if (reset) spiOnly = false;						// set again before the next transaction
+
+	return rdwr->nmsgs;
+}
@@ -0,0 +1,141 @@
+/****************************************************************************
+* I2C_Transport.h
+*
+* @about      : The backends that carry I2C_RDWR transactions for I2C_Bus.
+* @author     : Carlos Carrasquillo
+* @contact    : c.carrasquillo@ufl.edu
+* @date       : October 18, 2026
+* @modified   : October 18, 2026
+*
+* Property of ADAMUS lab, University of Florida.
+****************************************************************************/
+
+#ifndef I2C_TRANSPORT
+#define I2C_TRANSPORT
+
+
+/************************** Includes **************************/
+
+#include <stdint.h>
+#include <string>
+#include <linux/spi/spidev.h>
+#include "lsquaredc.h"
+
+
+/*************************** Defines ***************************/
+
+#define I2C_SPI_READ_BM		0x80		// set in the register byte of a read frame, clear for a write
+#define I2C_SPI_SPEED_HZ	1000000		// ICM20948 limit for any register
+#define I2C_SPI_BURST_HZ	7000000		// ICM20948 limit for reading the sensor and interrupt registers
+
+/* ICM20948 registers the transport needs to know about, all in bank 0 except REG_BANK_SEL */
+#define I2C_SPI_BANK_SEL	0x7F		// REG_BANK_SEL, followed so reads can be matched to their bank
+#define I2C_SPI_BANK_UNKNOWN 0xFF
+#define I2C_SPI_USER_CTRL	0x03
+#define I2C_SPI_IF_DIS_BM	(1 << 4)	// USER_CTRL.I2C_IF_DIS, SPI only until the next reset
+#define I2C_SPI_PWR_MGMT_1	0x06
+#define I2C_SPI_RESET_BM	(1 << 7)	// PWR_MGMT_1.DEVICE_RESET, back to bank 0 with I2C enabled
+#define I2C_SPI_INT_FIRST	0x19		// INT_STATUS .. INT_STATUS_3
+#define I2C_SPI_INT_LAST	0x1C
+#define I2C_SPI_DATA_FIRST	0x2D		// ACCEL_XOUT_H .. EXT_SLV_SENS_DATA_23
+#define I2C_SPI_DATA_LAST	0x52
+#define I2C_SPI_FIFO_R_W	0x72
+
+
+/************************** Transport **************************/
+
+/*
+ * Executes prebuilt message sequences with the semantics of the I2C_RDWR ioctl: the messages go out in order with
+ * repeated starts in between, the return value is the number of messages transferred, and -1 with errno set reports
+ * a failure. I2C_Bus serializes the calls, so a transport attached to a single bus needs no locking of its own.
+ */
+class I2C_Transport {
+public:
+	virtual ~I2C_Transport() {}
+	virtual int transfer(struct i2c_rdwr_ioctl_data* rdwr) = 0;
+	virtual uint64_t get_retries() { return 0; }				// transactions repeated internally so far
+};
+
+
+/*********************** Kernel Transport **********************/
+
+/* /dev/i2c-N through the kernel's i2c-dev driver, the default backend of every bus */
+class I2C_KernelTransport : public I2C_Transport {
+private:
+	uint8_t bus;
+	int handle;
+	uint64_t retries;
+
+	int connect();											// (re)opens the bus handle
+	void disconnect();										// closes the bus handle
+
+public:
+	explicit I2C_KernelTransport(uint8_t bus);
+	~I2C_KernelTransport();
+	I2C_KernelTransport(const I2C_KernelTransport&) = delete;
+	I2C_KernelTransport& operator=(const I2C_KernelTransport&) = delete;
+
+	/* reconnects and retries once if the adapter went away (ENODEV) */
+	int transfer(struct i2c_rdwr_ioctl_data* rdwr) override;
+	uint64_t get_retries() override { return retries; }
+};
+
+
+/************************ SPI Transport ************************/
+
+/*
+ * Carries register transactions to a sensor on /dev/spidevX.Y through the kernel's spidev driver, so a driver written
+ * against I2C_Functions runs unchanged on either bus:
+ *
+ *     I2C_Bus::attach(10, std::make_shared<I2C_SPITransport>("/dev/spidev0.0", IMU_I2C_ADDR));
+ *     ICM20948 icm(false, 10);			// bus 10 is now the SPI device
+ *
+ * Each register access becomes one chip select frame in the register-byte protocol of the ICM20948 (and most MEMS
+ * parts): a write message [reg, data...] goes out as is, and a write [reg] followed by a read becomes [reg | 0x80]
+ * with the data clocked back into the read buffer. The chip select is released between frames, and the whole
+ * transaction is still a single SPI_IOC_MESSAGE ioctl. Register banks need nothing special since REG_BANK_SEL is an
+ * ordinary register on both buses.
+ *
+ * The device on the chip select answers to 'address' only; messages for any other address fail with ENXIO, like an
+ * unacknowledged address on I2C. Register reads that do not follow their address, and writes of registers above 0x7F,
+ * have no SPI equivalent and fail with EINVAL.
+ *
+ * The ICM20948 only allows 'burst_hz' (7 MHz) for reads of the sensor data, FIFO_R_W and INT_STATUS* in bank 0, and
+ * 'speed_hz' (1 MHz) for everything else, so the transport follows the REG_BANK_SEL writes that pass through it. Until
+ * the bank is known (and after a transfer fails) every frame goes at 'speed_hz'. Before its first transaction, and
+ * again after a DEVICE_RESET, the transport sets USER_CTRL.I2C_IF_DIS, so a glitch on the shared pins can no longer
+ * switch the chip back to I2C mode.
+ */
+class I2C_SPITransport : public I2C_Transport {
+private:
+	std::string device;
+	uint8_t address;
+	uint32_t speedHz, burstHz;
+	uint8_t mode;
+	int handle;
+	struct spi_ioc_transfer xfers[I2C_RDWR_IOCTL_MAX_MSGS];	// never more than one per message
+	uint8_t headers[I2C_RDWR_IOCTL_MAX_MSGS];				// register bytes of the read frames
+	uint8_t bank;											// last REG_BANK_SEL value written, or I2C_SPI_BANK_UNKNOWN
+	bool spiOnly;											// I2C_IF_DIS set since the last reset
+
+	int connect();											// opens and configures the spidev handle
+	void disconnect();
+	int disableI2C();										// read-modify-write of USER_CTRL.I2C_IF_DIS
+	int frame(uint8_t reg, uint8_t* data, uint32_t len, bool read);	// one register frame at 'speed_hz'
+	static bool burstRegister(uint8_t bank, uint8_t reg);
+
+protected:
+	/* performs the frames, a single ioctl on the spidev handle; overridden by stand-ins such as SimICM20948SPI */
+	virtual int exchange(struct spi_ioc_transfer* xfers, uint32_t count);
+
+public:
+	I2C_SPITransport(const std::string& device, uint8_t address, uint32_t speed_hz = I2C_SPI_SPEED_HZ,
+	                 uint32_t burst_hz = I2C_SPI_BURST_HZ, uint8_t mode = SPI_MODE_3);
+	~I2C_SPITransport();
+	I2C_SPITransport(const I2C_SPITransport&) = delete;
+	I2C_SPITransport& operator=(const I2C_SPITransport&) = delete;
+
+	int transfer(struct i2c_rdwr_ioctl_data* rdwr) override;
+};
+
+#endif // I2C_TRANSPORT
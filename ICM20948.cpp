@@ -12,16 +12,103 @@
  ****************************************************************************/
 
 
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
 #include "ICM20948.h"
+#include "IMU_Convert.h"
 
 
 ICM20948::ICM20948(bool debug, uint8_t bus, uint8_t address) {
 	this->debug = debug;
 	i2c = I2C_Functions(bus, address);
+	invalidateCache();
+	magEnabled = false;
+	fifoPacketLen = 0;
+	fifoOverflows = 0;
+	readErrors = 0;
+	fifoIndex = 0;
+	fifoClock.setRate(IMU_BASE_ODR);
 }
 
 void ICM20948::selectBankReg(uint8_t bank) {
-	i2c.write(REG_BANK_SEL, bank);
+	if (bank == currentBank) return;	// already selected, skip the bus write
+
+	int status = i2c.write(REG_BANK_SEL, bank);
+	currentBank = (status < 0) ? REG_BANK_UNKNOWN : bank;
+}
+
+/*
+ * The bank selection and the sensitivity configuration only change through this class, so they are shadowed
+ * instead of being read back before every sample. Call invalidateCache() (or resync()) whenever the device may
+ * have changed behind our back, e.g. after a DEVICE_RESET or a power cycle.
+ */
+void ICM20948::invalidateCache() {
+	currentBank = REG_BANK_UNKNOWN;
+	accConfig = -1;
+	gyroConfig = -1;
+	accDiv = -1;
+	gyroDiv = -1;
+}
+
+void ICM20948::resync() {
+	invalidateCache();
+	readConfig(ACCEL_CONFIG_1, accConfig);
+	readConfig(GYRO_CONFIG_1, gyroConfig);
+	readDividers();
+	selectBankReg(REG_BANK_0);
+}
+
+/* the shadow is only filled from a read that completed, so a bus error is retried next time instead of cached */
+int ICM20948::readConfig(uint8_t reg, int& shadow) {
+	/* both configuration registers live in bank 2 */
+	if (shadow < 0) {
+		uint8_t value;
+		selectBankReg(REG_BANK_2);
+		if (currentBank != REG_BANK_2 || i2c.readn(reg, 1, &value) == NULL) {
+			TRACE_ERROR("configuration register 0x%02x could not be read (errno %d)", reg, errno);
+			return -1;
+		}
+		shadow = value;
+	}
+
+	return shadow;
+}
+
+/* read-modify-write of the bits in 'mask' of a bank 2 configuration register, keeping the shadow in step */
+int ICM20948::writeConfig(uint8_t reg, int& shadow, uint8_t mask, uint8_t value) {
+	int current = readConfig(reg, shadow);
+	if (current < 0) return -1;			// never write back bits that were not read
+	uint8_t config = (current & ~mask) | value;		// all other bits remain unaltered
+	selectBankReg(REG_BANK_2);
+	int status = i2c.write(reg, config);
+	shadow = (status < 0) ? -1 : config;
+
+	return (status < 0) ? -1 : 0;
+}
+
+int ICM20948::readDividers() {
+	if (gyroDiv < 0) {
+		uint8_t div;
+		selectBankReg(REG_BANK_2);
+		if (currentBank != REG_BANK_2 || i2c.readn(GYRO_SMPLRT_DIV, 1, &div) == NULL) {
+			TRACE_ERROR("the gyroscope divider could not be read (errno %d)", errno);
+			return -1;
+		}
+		gyroDiv = div;
+	}
+	if (accDiv < 0) {
+		uint8_t div[2];
+		selectBankReg(REG_BANK_2);
+		if (currentBank != REG_BANK_2 || i2c.readn(ACCEL_SMPLRT_DIV_1, 2, div) == NULL) {
+			TRACE_ERROR("the accelerometer divider could not be read (errno %d)", errno);
+			return -1;
+		}
+		accDiv = ((div[0] & 0x0F) << 8) | div[1];
+	}
+
+	return 0;
 }
 
 bool ICM20948::whoAmI() {
@@ -60,6 +147,7 @@ int ICM20948::enableSleep() {
 
 uint16_t ICM20948::getStatus() {
 	uint8_t status[2];
+	selectBankReg(REG_BANK_0);
 	status[0] = i2c.read(PWR_MGMT_1);
 	status[1] = i2c.read(PWR_MGMT_2);
 
@@ -97,32 +185,124 @@ uint16_t ICM20948::getStatus() {
 
 float ICM20948::getTemperature() {
 	selectBankReg(REG_BANK_0);
-	uint16_t raw = i2c.read2(TEMP_OUT_H);
-	float temperature = (float)((( (float)(raw - 21) )/333.87) + 21);
+	int16_t raw = (int16_t)i2c.read2(TEMP_OUT_H);
+	float temperature = toCelsius(raw);
 
-	if (debug && (temperature < 10 || temperature > 40)) printe("The temperature is out of the typical range for debugging.");
+	if (temperature < 10 || temperature > 40) TRACE_INFO("temperature %d C is out of the typical range", (int)temperature);
 
 	return temperature;
 }
 
+int ICM20948::readIMUBurst(uint8_t* raw) {
+	/* the accelerometer, gyroscope and temperature registers are contiguous, so one burst yields a coherent sample */
+	int status = 0;
+	if (currentBank == REG_BANK_0) {
+		if (i2c.readn(ACCEL_XOUT_H, getDataLen(), raw) == NULL) status = -1;
+	} else {
+		/* fold the bank switch into the same ioctl as the burst read */
+		I2C_Queue queue;
+		uint8_t bank = REG_BANK_0;
+		queue.add_write(i2c, REG_BANK_SEL, &bank, 1);
+		queue.add_read(i2c, ACCEL_XOUT_H, raw, getDataLen());
+		int completed = queue.submit();
+		currentBank = (queue.result(0) == 0) ? REG_BANK_0 : REG_BANK_UNKNOWN;
+		if (completed < 2 || queue.result(1) != 0) status = -1;		// the bank switch alone is not a sample
+	}
+
+	/* a failed read must not be decoded as a sample */
+	if (status < 0) {
+		memset(raw, 0, getDataLen());
+		readErrors++;
+		TRACE_ERROR("burst read failed (errno %d), sample discarded", errno);
+	}
+
+	return status;
+}
+
 ICM20948::imu_t ICM20948::getIMUData() {
 	imu_t imu;
 
-	acc_t acc = getAccData();
-	gyro_t gyro = getGyroData();
-	float temperature = getTemperature();
+	uint8_t raw[IMU_MAX_DATA_LEN];
+	if (readIMUBurst(raw) < 0) {
+		imu = imu_t();					// all zero, timestamp 0: no sample
+		return imu;
+	}
+	decodeIMUData(raw, true, imu, magEnabled);
+	imu.timestamp = monotonicTime();
 
-	imu.ax = acc.x;
-	imu.ay = acc.y;
-	imu.az = acc.z;
-	imu.gx = gyro.x;
-	imu.gy = gyro.y;
-	imu.gz = gyro.z;
-	imu.temperature = temperature;
+	if (imu.temperature < 10 || imu.temperature > 40) TRACE_INFO("temperature %d C is out of the typical range", (int)imu.temperature);
 
 	return imu;
 }
 
+ICM20948::raw_t ICM20948::getRawData() {
+	raw_t sample;
+
+	uint8_t raw[IMU_MAX_DATA_LEN];
+	if (readIMUBurst(raw) < 0) {
+		sample = raw_t();
+		return sample;
+	}
+	decodeRawData(raw, true, sample, magEnabled);
+	sample.timestamp = monotonicTime();
+
+	return sample;
+}
+
+void ICM20948::decodeRawData(const uint8_t* raw, bool temperature, raw_t& sample, bool mag) {
+	sample.ax = toInt16(&raw[0]);
+	sample.ay = toInt16(&raw[2]);
+	sample.az = toInt16(&raw[4]);
+	sample.gx = toInt16(&raw[6]);
+	sample.gy = toInt16(&raw[8]);
+	sample.gz = toInt16(&raw[10]);
+	sample.temperature = temperature ? toInt16(&raw[12]) : 0;
+	sample.mx = mag ? toInt16LE(&raw[IMU_DATA_LEN + 0]) : 0;
+	sample.my = mag ? toInt16LE(&raw[IMU_DATA_LEN + 2]) : 0;
+	sample.mz = mag ? toInt16LE(&raw[IMU_DATA_LEN + 4]) : 0;
+	sample.timestamp = 0;
+}
+
+uint8_t ICM20948::getDeviceID() {
+	selectBankReg(REG_BANK_0);
+	return i2c.read(WHO_AM_I);
+}
+
+/*
+ * Lets several sensors on one bus be sampled in a single ioctl: the burst read for this sensor is appended to 'queue'
+ * and, once the queue is submitted, 'raw' (getDataLen() bytes) can be passed to decodeIMUData().
+ */
+int ICM20948::queueIMUData(I2C_Queue& queue, uint8_t* raw) {
+	selectBankReg(REG_BANK_0);
+	return queue.add_read(i2c, ACCEL_XOUT_H, raw, getDataLen());
+}
+
+void ICM20948::decodeIMUData(const uint8_t* raw, bool temperature, imu_t& imu, bool mag) {
+	/* raw holds the accelerometer and gyroscope registers, optionally followed by the temperature */
+	int accSens = getAccSens();
+	float gyroSens = getGyroSens();
+	if (accSens < 0 || gyroSens < 0) {
+		imu = imu_t();
+		return;
+	}
+
+	float accScale = 1.0f / accSens;
+	float gyroScale = 1.0f / gyroSens;
+	imu.ax = (float)toInt16(&raw[0]) * accScale;
+	imu.ay = (float)toInt16(&raw[2]) * accScale;
+	imu.az = (float)toInt16(&raw[4]) * accScale;
+	imu.gx = (float)toInt16(&raw[6]) * gyroScale;
+	imu.gy = (float)toInt16(&raw[8]) * gyroScale;
+	imu.gz = (float)toInt16(&raw[10]) * gyroScale;
+	imu.temperature = temperature ? toCelsius(toInt16(&raw[12])) : 0;
+
+	/* the AK09916 axes are X, -Y, -Z of the accelerometer; rotate them so all three sensors share one frame */
+	imu.mx = mag ? (float)toInt16LE(&raw[IMU_DATA_LEN + 0]) / MAG_SENS : 0;
+	imu.my = mag ? -(float)toInt16LE(&raw[IMU_DATA_LEN + 2]) / MAG_SENS : 0;
+	imu.mz = mag ? -(float)toInt16LE(&raw[IMU_DATA_LEN + 4]) / MAG_SENS : 0;
+	imu.timestamp = 0;
+}
+
 /********************************* Accelerometer *********************************/
 
 int ICM20948::setAccSens(uint8_t scale){
@@ -131,20 +311,14 @@ int ICM20948::setAccSens(uint8_t scale){
 		return -1;
 	}
 
-	selectBankReg(REG_BANK_2);
-	uint8_t config = i2c.read(ACCEL_CONFIG_1);
-	config &= (config & ~SENSITIVITY_BM) | scale;		// all bits but the sensitivity bits remain unaltered
-	i2c.write(ACCEL_CONFIG_1, config);
-
-	return 0;
+	return writeConfig(ACCEL_CONFIG_1, accConfig, SENSITIVITY_BM, scale);
 }
 
 int ICM20948::getAccSens() {
 	int sens; 		// units: LSB/g
-	uint8_t raw;
-
-	selectBankReg(REG_BANK_2);
-	raw = i2c.read(ACCEL_CONFIG_1) & SENSITIVITY_BM;
+	int config = readConfig(ACCEL_CONFIG_1, accConfig);
+	if (config < 0) return -1;
+	uint8_t raw = config & SENSITIVITY_BM;
 
 	switch (raw) {
 		case ACCEL_SENS_2G:  sens = 16384; break;  // 2^15 / 2
@@ -159,24 +333,19 @@ int ICM20948::getAccSens() {
 }
 
 ICM20948::acc_t ICM20948::getAccData() {
-	int16_t rawAccX, rawAccY, rawAccZ; 
 	acc_t acc;
 
-	int sens = getAccSens();
+	int sens = getAccSens();		// shadowed, no bus access once known
 	if (sens < 0) return {0.0, 0.0, 0.0};
+	float scale = 1.0f / sens;
 	
 	selectBankReg(REG_BANK_0);
 	uint8_t raw[6];
 	i2c.readn(ACCEL_XOUT_H, 6, raw);	// raw is returned with the desired data
 
-	rawAccX = ((int16_t)raw[0] << 8) | raw[1];
-	acc.x = (float)rawAccX / (float)sens;
-
-	rawAccY = ((int16_t)raw[2] << 8) | raw[3];
-	acc.y = (float)rawAccY / (float)sens;
-
-	rawAccZ = ((int16_t)raw[4] << 8) | raw[5];
-	acc.z = (float)rawAccZ / (float)sens;
+	acc.x = (float)toInt16(&raw[0]) * scale;
+	acc.y = (float)toInt16(&raw[2]) * scale;
+	acc.z = (float)toInt16(&raw[4]) * scale;
 
 	return acc;
 }
@@ -189,20 +358,14 @@ int ICM20948::setGyroSens(uint8_t scale){
 		return -1;
 	}
 
-	selectBankReg(REG_BANK_2);
-	uint8_t config = i2c.read(GYRO_CONFIG_1);
-	config &= (config & ~SENSITIVITY_BM) | scale;		// all bits but the sensitivity bits remain unaltered
-	i2c.write(GYRO_CONFIG_1, config);
-
-	return 0;
+	return writeConfig(GYRO_CONFIG_1, gyroConfig, SENSITIVITY_BM, scale);
 }
 
 float ICM20948::getGyroSens() {
 	float sens; 	// units: LSB/g
-	uint8_t raw;
-
-	selectBankReg(REG_BANK_2);
-	raw = i2c.read(GYRO_CONFIG_1) & SENSITIVITY_BM;
+	int config = readConfig(GYRO_CONFIG_1, gyroConfig);
+	if (config < 0) return -1;
+	uint8_t raw = config & SENSITIVITY_BM;
 
 	switch (raw) {
 		case GYRO_SENS_250DPS:  sens = 131.072; break;	// 2^15 / 250
@@ -217,24 +380,437 @@ float ICM20948::getGyroSens() {
 }
 
 ICM20948::gyro_t ICM20948::getGyroData() {
-	int16_t rawGyroX, rawGyroY, rawGyroZ; 
 	gyro_t gyro;
 
-	float sens = getGyroSens();
+	float sens = getGyroSens();		// shadowed, no bus access once known
 	if (sens < 0) return {0.0, 0.0, 0.0};
+	float scale = 1.0f / sens;
 
 	selectBankReg(REG_BANK_0);
 	uint8_t raw[6];
 	i2c.readn(GYRO_XOUT_H, 6, raw);
 
-	rawGyroX = ((int16_t)raw[0] << 8) | raw[1];
-	gyro.x = (float)rawGyroX / sens;
+	gyro.x = (float)toInt16(&raw[0]) * scale;
+	gyro.y = (float)toInt16(&raw[2]) * scale;
+	gyro.z = (float)toInt16(&raw[4]) * scale;
 
-	rawGyroY = ((int16_t)raw[2] << 8) | raw[3];
-	gyro.y = (float)rawGyroY / sens;
+	return gyro;
+}
+
+/************************ Output Data Rate and Bandwidth *************************/
+
+/*
+ * With the low-pass filter enabled (FCHOICE = 1, the reset state) each sensor produces samples at its base rate
+ * divided by 1 + its sample rate divider; bypassing the filter runs the sensor unfiltered at 9 kHz (gyroscope) or
+ * 4.5 kHz (accelerometer) and ignores the divider. The data registers cannot change faster than getDataRate(), so
+ * polling faster than that only reads the same sample again (see IMU::startSampler() and IMUManager, which pace
+ * themselves to it). The FIFO timestamps follow the new rate as well.
+ */
+static const float gyroBandwidth[8] = {196.6f, 151.8f, 119.5f, 51.2f, 23.9f, 11.6f, 5.7f, 361.4f};
+static const float accBandwidth[8] = {246.0f, 246.0f, 111.4f, 50.4f, 23.9f, 11.5f, 5.7f, 473.0f};
+
+float ICM20948::setAccRate(float rate) {
+	if (rate <= 0) {
+		printe("An appropriate accelerometer rate was not selected.");
+		return -1;
+	}
 
-	rawGyroZ = ((int16_t)raw[4] << 8) | raw[5];
-	gyro.z = (float)rawGyroZ / sens;
+	long div = lroundf(ACCEL_BASE_ODR / rate) - 1;
+	if (div < 0) div = 0;
+	if (div > ACCEL_MAX_DIV) div = ACCEL_MAX_DIV;
 
-	return gyro;
+	uint8_t raw[2] = {(uint8_t)(div >> 8), (uint8_t)(div & 0xFF)};
+	selectBankReg(REG_BANK_2);
+	int status = i2c.writen(ACCEL_SMPLRT_DIV_1, raw, 2);
+	accDiv = (status < 0) ? -1 : div;
+	if (status < 0) return -1;
+
+	int config = readConfig(ACCEL_CONFIG_1, accConfig);
+	if (config >= 0 && !(config & FCHOICE_BM)) printi("The accelerometer divider is ignored while its DLPF is bypassed.");
+	float odr = getDataRate();
+	if (odr > 0) fifoClock.setRate(odr);
+
+	return getAccRate();
+}
+
+float ICM20948::setGyroRate(float rate) {
+	if (rate <= 0) {
+		printe("An appropriate gyroscope rate was not selected.");
+		return -1;
+	}
+
+	long div = lroundf(GYRO_BASE_ODR / rate) - 1;
+	if (div < 0) div = 0;
+	if (div > GYRO_MAX_DIV) div = GYRO_MAX_DIV;
+
+	selectBankReg(REG_BANK_2);
+	int status = i2c.write(GYRO_SMPLRT_DIV, (uint8_t)div);
+	gyroDiv = (status < 0) ? -1 : div;
+	if (status < 0) return -1;
+
+	int config = readConfig(GYRO_CONFIG_1, gyroConfig);
+	if (config >= 0 && !(config & FCHOICE_BM)) printi("The gyroscope divider is ignored while its DLPF is bypassed.");
+	float odr = getDataRate();
+	if (odr > 0) fifoClock.setRate(odr);
+
+	return getGyroRate();
+}
+
+float ICM20948::getAccRate() {
+	int config = readConfig(ACCEL_CONFIG_1, accConfig);
+	if (config < 0) return -1;
+	if (!(config & FCHOICE_BM)) return ACCEL_BYPASS_ODR;
+
+	if (readDividers() < 0) return -1;
+	return ACCEL_BASE_ODR / (1 + accDiv);
+}
+
+float ICM20948::getGyroRate() {
+	int config = readConfig(GYRO_CONFIG_1, gyroConfig);
+	if (config < 0) return -1;
+	if (!(config & FCHOICE_BM)) return GYRO_BYPASS_ODR;
+
+	if (readDividers() < 0) return -1;
+	return GYRO_BASE_ODR / (1 + gyroDiv);
+}
+
+float ICM20948::getDataRate() {
+	float acc = getAccRate();
+	float gyro = getGyroRate();
+	if (acc < 0 || gyro < 0) return -1;
+
+	return (acc > gyro) ? acc : gyro;
+}
+
+int ICM20948::setAccDLPF(uint8_t dlpf) {
+	if (dlpf > DLPF_BYPASS) {
+		printe("An appropriate accelerometer DLPF setting was not selected.");
+		return -1;
+	}
+
+	uint8_t value = (dlpf == DLPF_BYPASS) ? 0 : ((dlpf << 3) | FCHOICE_BM);
+	int status = writeConfig(ACCEL_CONFIG_1, accConfig, DLPFCFG_BM | FCHOICE_BM, value);
+	float odr = getDataRate();
+	if (odr > 0) fifoClock.setRate(odr);
+
+	return status;
+}
+
+int ICM20948::setGyroDLPF(uint8_t dlpf) {
+	if (dlpf > DLPF_BYPASS) {
+		printe("An appropriate gyroscope DLPF setting was not selected.");
+		return -1;
+	}
+
+	uint8_t value = (dlpf == DLPF_BYPASS) ? 0 : ((dlpf << 3) | FCHOICE_BM);
+	int status = writeConfig(GYRO_CONFIG_1, gyroConfig, DLPFCFG_BM | FCHOICE_BM, value);
+	float odr = getDataRate();
+	if (odr > 0) fifoClock.setRate(odr);
+
+	return status;
+}
+
+float ICM20948::getAccBandwidth() {
+	int config = readConfig(ACCEL_CONFIG_1, accConfig);
+	if (config < 0) return -1;
+	if (!(config & FCHOICE_BM)) return 1209.0f;
+
+	return accBandwidth[(config & DLPFCFG_BM) >> 3];
+}
+
+float ICM20948::getGyroBandwidth() {
+	int config = readConfig(GYRO_CONFIG_1, gyroConfig);
+	if (config < 0) return -1;
+	if (!(config & FCHOICE_BM)) return 12106.0f;
+
+	return gyroBandwidth[(config & DLPFCFG_BM) >> 3];
+}
+
+
+/********************************* Magnetometer **********************************/
+
+/*
+ * The AK09916 sits on the ICM20948's auxiliary I2C bus, so the host never talks to it directly. Once enabled, the
+ * internal I2C master reads HXL..ST2 through I2C_SLV0 after every accelerometer/gyroscope sample and copies it into
+ * EXT_SLV_SENS_DATA_00, right behind TEMP_OUT_L: the regular burst read simply grows by MAG_DATA_LEN bytes and all
+ * nine axes arrive in the same transaction, at the full ODR. The magnetometer itself measures at up to 100 Hz, so
+ * consecutive samples repeat its last measurement in between.
+ *
+ * Configuration writes and reads go through I2C_SLV4, which performs a single transfer on request.
+ */
+int ICM20948::enableMag(uint8_t mode) {
+	if (mode != MAG_MODE_10HZ && mode != MAG_MODE_20HZ && mode != MAG_MODE_50HZ && mode != MAG_MODE_100HZ) {
+		printe("An appropriate magnetometer mode was not selected.");
+		return -1;
+	}
+
+	int status = 0;
+	selectBankReg(REG_BANK_0);
+	uint8_t userCtrl = i2c.read(USER_CTRL);
+	status += (i2c.write(USER_CTRL, userCtrl | I2C_MST_EN_BM) < 0) ? -1 : 0;
+	selectBankReg(REG_BANK_3);
+	status += (i2c.write(I2C_MST_CTRL, I2C_MST_CLK) < 0) ? -1 : 0;
+
+	uint8_t id = 0;
+	if (status < 0 || magRead(MAG_WIA2, id) < 0 || id != MAG_DEVICE_ID) {
+		printe("The magnetometer did not respond.");
+		return -1;
+	}
+
+	status += magWrite(MAG_CNTL3, MAG_SRST);
+	usleep(1000);												// reset completes within 100us
+	status += magWrite(MAG_CNTL2, mode);
+
+	selectBankReg(REG_BANK_3);
+	status += (i2c.write(I2C_SLV0_ADDR, SLV_READ | MAG_I2C_ADDR) < 0) ? -1 : 0;
+	status += (i2c.write(I2C_SLV0_REG, MAG_HXL) < 0) ? -1 : 0;
+	status += (i2c.write(I2C_SLV0_CTRL, SLV_EN | MAG_DATA_LEN) < 0) ? -1 : 0;
+	selectBankReg(REG_BANK_0);
+	if (status < 0) {
+		printe("The magnetometer could not be configured.");
+		return -1;
+	}
+
+	magEnabled = true;
+	printi("Magnetometer enabled.");
+
+	return 0;
+}
+
+int ICM20948::disableMag() {
+	magEnabled = false;
+
+	selectBankReg(REG_BANK_3);
+	int status = (i2c.write(I2C_SLV0_CTRL, 0) < 0) ? -1 : 0;
+	status += magWrite(MAG_CNTL2, MAG_MODE_POWER_DOWN);
+
+	selectBankReg(REG_BANK_0);
+	uint8_t userCtrl = i2c.read(USER_CTRL);
+	status += (i2c.write(USER_CTRL, userCtrl & ~I2C_MST_EN_BM) < 0) ? -1 : 0;
+
+	return (status < 0) ? -1 : 0;
+}
+
+/* starts the single I2C_SLV4 transfer set up by the caller and waits for the master to complete it */
+int ICM20948::waitSLV4() {
+	selectBankReg(REG_BANK_3);
+	if (i2c.write(I2C_SLV4_CTRL, SLV_EN) < 0) return -1;
+
+	/* the master runs once per internal sample, so this takes at most ~1ms at the base ODR */
+	selectBankReg(REG_BANK_0);
+	for (int tries = 0; tries < 100; tries++) {
+		uint8_t mstStatus = i2c.read(I2C_MST_STATUS);
+		if (mstStatus & SLV4_NACK_BM) return -1;
+		if (mstStatus & SLV4_DONE_BM) return 0;
+		usleep(100);
+	}
+
+	return -1;
+}
+
+int ICM20948::magWrite(uint8_t reg, uint8_t data) {
+	selectBankReg(REG_BANK_3);
+	int status = i2c.write(I2C_SLV4_ADDR, MAG_I2C_ADDR);
+	if (status >= 0) status = i2c.write(I2C_SLV4_REG, reg);
+	if (status >= 0) status = i2c.write(I2C_SLV4_DO, data);
+
+	return (status < 0) ? -1 : waitSLV4();
+}
+
+int ICM20948::magRead(uint8_t reg, uint8_t& data) {
+	selectBankReg(REG_BANK_3);
+	int status = i2c.write(I2C_SLV4_ADDR, SLV_READ | MAG_I2C_ADDR);
+	if (status >= 0) status = i2c.write(I2C_SLV4_REG, reg);
+	if (status < 0 || waitSLV4() < 0) return -1;
+
+	selectBankReg(REG_BANK_3);
+	data = i2c.read(I2C_SLV4_DI);
+
+	return 0;
+}
+
+
+/****************************** Data Ready Interrupt *****************************/
+
+/*
+ * Configures INT1 to emit a 50us active-high pulse whenever a new sample lands in the data registers, so the host can
+ * wait on the rising edge (see DataReady.h) instead of polling. The pulse needs no acknowledgement over the bus.
+ */
+int ICM20948::enableDataReadyInterrupt() {
+	selectBankReg(REG_BANK_0);
+	uint8_t pinCfg = i2c.read(INT_PIN_CFG);
+	pinCfg &= ~(INT1_ACTL_BM | INT1_LATCH_BM);		// push-pull, active high, pulsed
+
+	int status = i2c.write(INT_PIN_CFG, pinCfg);
+	if (status >= 0) status = i2c.write(INT_ENABLE_1, RAW_DATA_RDY_EN);
+	if (status < 0) {
+		printe("The data ready interrupt could not be enabled.");
+		return -1;
+	}
+
+	return 0;
+}
+
+int ICM20948::disableDataReadyInterrupt() {
+	selectBankReg(REG_BANK_0);
+	return (i2c.write(INT_ENABLE_1, 0) < 0) ? -1 : 0;
+}
+
+
+/********************************* FIFO Streaming ********************************/
+
+/*
+ * In streaming mode the chip queues every accelerometer/gyroscope (and optionally temperature) sample into its FIFO
+ * at the configured ODR, and readFIFO() drains whole batches in one bulk read of FIFO_R_W. The FIFO runs in snapshot
+ * mode, so once it is full new samples are dropped rather than overwriting old ones; this keeps the packets aligned,
+ * and the loss is reported through FIFO_OVERFLOW_INT (see readFIFO()).
+ */
+int ICM20948::enableFIFO(bool temperature) {
+	int status = 0;
+
+	selectBankReg(REG_BANK_0);
+	uint8_t userCtrl = i2c.read(USER_CTRL);
+	uint8_t sources = ACCEL_FIFO_EN | GYRO_FIFO_EN | (temperature ? TEMP_FIFO_EN : 0);
+
+	status += (i2c.write(FIFO_EN_1, 0) < 0) ? -1 : 0;						// no external sensors
+	status += (i2c.write(FIFO_EN_2, sources) < 0) ? -1 : 0;
+	status += (i2c.write(FIFO_MODE, FIFO_ALL_BM) < 0) ? -1 : 0;			// snapshot mode
+	status += (i2c.write(INT_ENABLE_2, FIFO_ALL_BM) < 0) ? -1 : 0;		// latch overflows in INT_STATUS_2
+	status += (i2c.write(USER_CTRL, userCtrl | FIFO_EN_BM) < 0) ? -1 : 0;
+	if (status < 0) {
+		printe("The FIFO could not be configured.");
+		return -1;
+	}
+
+	fifoPacketLen = FIFO_PACKET_LEN + (temperature ? FIFO_TEMP_LEN : 0);
+	fifoBuf.resize(FIFO_SIZE);
+	fifoTimes.resize(FIFO_SIZE / FIFO_PACKET_LEN);
+	printi("FIFO streaming enabled.");
+
+	return resetFIFO();
+}
+
+int ICM20948::disableFIFO() {
+	selectBankReg(REG_BANK_0);
+	uint8_t userCtrl = i2c.read(USER_CTRL);
+	int status = i2c.write(USER_CTRL, userCtrl & ~FIFO_EN_BM);
+	i2c.write(FIFO_EN_2, 0);
+	i2c.write(INT_ENABLE_2, 0);
+	fifoPacketLen = 0;
+
+	return (status < 0) ? -1 : 0;
+}
+
+int ICM20948::resetFIFO() {
+	selectBankReg(REG_BANK_0);
+	int status = i2c.write(FIFO_RST, FIFO_ALL_BM);
+	if (status >= 0) status = i2c.write(FIFO_RST, 0);
+
+	uint8_t intStatus;
+	i2c.readn(INT_STATUS_2, 1, &intStatus);			// clears any stale overflow flag
+
+	/* packet indices restart from an empty FIFO, the fitted period carries over */
+	fifoIndex = 0;
+	fifoClock.restart();
+
+	return (status < 0) ? -1 : 0;
+}
+
+int ICM20948::getFIFOCount() {
+	selectBankReg(REG_BANK_0);
+	return i2c.read2(FIFO_COUNTH) & FIFO_COUNT_BM;
+}
+
+/* bulk reads up to 'max_samples' whole packets into fifoBuf, returns how many or -1 on error */
+int ICM20948::drainFIFO(int max_samples) {
+	if (fifoPacketLen == 0) {
+		printe("The FIFO has not been enabled.");
+		return -1;
+	}
+
+	/* the overflow flag is cleared on read, so it is sampled before the count; both go out in one ioctl */
+	selectBankReg(REG_BANK_0);
+	uint8_t intStatus = 0;
+	uint8_t rawCount[2] = {0, 0};
+	I2C_Queue queue;
+	queue.add_read(i2c, INT_STATUS_2, &intStatus, 1);
+	queue.add_read(i2c, FIFO_COUNTH, rawCount, 2);
+	if (queue.submit() < 2) return -1;
+	uint64_t readTime = monotonicTime();
+
+	bool overflow = intStatus & FIFO_ALL_BM;
+	int count = (((int)rawCount[0] << 8) | rawCount[1]) & FIFO_COUNT_BM;
+	int queued = count / fifoPacketLen;
+	int packets = queued;
+	if (packets > max_samples) packets = max_samples;
+	if (packets > FIFO_SIZE / fifoPacketLen) packets = FIFO_SIZE / fifoPacketLen;
+
+	/* a failed drain may have consumed part of a packet, so the FIFO is realigned and the clock fit starts over */
+	if (packets > 0 && i2c.readn(FIFO_R_W, packets * fifoPacketLen, fifoBuf.data()) == NULL) {		// FIFO_R_W does not auto-increment
+		readErrors++;
+		TRACE_ERROR("FIFO drain of %d packets failed (errno %d), the FIFO is reset", packets, errno);
+		resetFIFO();
+		return -1;
+	}
+
+	/* the newest queued packet was sampled within the last period before the count was read, half of one on average */
+	if (queued > 0 && !overflow) fifoClock.observe(fifoIndex + queued - 1, readTime - (uint64_t)(fifoClock.getPeriod() / 2));
+
+	for (int i = 0; i < packets; i++) fifoTimes[i] = fifoClock.timeOf(fifoIndex + i);
+	fifoIndex += packets;
+
+	/* samples were dropped after the ones just drained; restart from an empty, packet-aligned FIFO */
+	if (overflow) {
+		fifoOverflows++;
+		TRACE_ERROR("FIFO overflow after %llu packets, samples were lost", (unsigned long long)fifoIndex);
+		resetFIFO();
+	}
+
+	return packets;
+}
+
+/*
+ * Packets carry no time of their own. Every drain tells fifoClock which packet index was the newest one at the time
+ * of the read; the packets are then stamped from its running fit, which follows the sensor's real rate rather than
+ * the nominal ODR. The times still include the constant part of the bus latency.
+ */
+int ICM20948::readFIFO(imu_t* samples, int max_samples) {
+	int packets = drainFIFO(max_samples);
+
+	for (int i = 0; i < packets; i++) {
+		decodeIMUData(&fifoBuf[i * fifoPacketLen], fifoPacketLen > FIFO_PACKET_LEN, samples[i]);
+		samples[i].timestamp = fifoTimes[i];
+	}
+
+	return packets;
+}
+
+/* converts the whole drain in one pass of the batch kernel instead of one sample at a time */
+int ICM20948::readFIFO(soa_t samples, int max_samples) {
+	int accSens = getAccSens();
+	float gyroSens = getGyroSens();
+	if (accSens < 0 || gyroSens < 0) return -1;
+
+	int packets = drainFIFO(max_samples);
+	if (packets <= 0) return packets;
+
+	if (fifoPacketLen == FIFO_PACKET_LEN) samples.temperature = NULL;
+	convertPackets(fifoBuf.data(), fifoPacketLen, packets, accSens, gyroSens, samples);
+	if (samples.timestamp != NULL) {
+		for (int i = 0; i < packets; i++) samples.timestamp[i] = fifoTimes[i];
+	}
+
+	return packets;
+}
+
+uint32_t ICM20948::getReadErrors() {
+	return readErrors;
+}
+
+uint32_t ICM20948::getFIFOOverflows() {
+	return fifoOverflows;
+}
+
+SampleClock::stats_t ICM20948::getFIFOClockStats() {
+	return fifoClock.getStats();
 }
\ No newline at end of file
@@ -19,7 +19,11 @@
 #include <stdio.h>
 #include <string>
 #include <iostream>
+#include <vector>
+#include <time.h>
 #include "I2C_Functions.h"
+#include "SampleClock.h"
+#include "Trace.h"
 
 /********************************** Defines *********************************/
 /*
@@ -33,11 +37,19 @@
 #define REG_BANK_1 (1 << 4)
 #define REG_BANK_2 (2 << 4)
 #define REG_BANK_3 (3 << 4)
+#define REG_BANK_UNKNOWN 0xFF 		// shadow value when the selected bank is not known
 
 /* User Bank Register 0 definitions */
 #define WHO_AM_I     0x00  		// 0xEA by default
+#define USER_CTRL    0x03
 #define PWR_MGMT_1   0x06
 #define PWR_MGMT_2	 0x07
+#define INT_PIN_CFG  0x0F
+#define INT_ENABLE_1 0x11
+#define INT_ENABLE_2 0x12
+#define INT_STATUS_1 0x1A
+#define INT_STATUS_2 0x1B
+#define I2C_MST_STATUS 0x17
 #define ACCEL_XOUT_H 0x2D
 #define ACCEL_XOUT_L 0x2E 
 #define ACCEL_YOUT_H 0x2F
@@ -52,11 +64,65 @@
 #define GYRO_ZOUT_L  0x38
 #define TEMP_OUT_H   0x39
 #define TEMP_OUT_L   0x3A
+#define EXT_SLV_SENS_DATA_00 0x3B 	// first of 24 registers filled by the I2C master's slave reads
+#define FIFO_EN_1    0x66
+#define FIFO_EN_2    0x67
+#define FIFO_RST     0x68
+#define FIFO_MODE    0x69
+#define FIFO_COUNTH  0x70
+#define FIFO_COUNTL  0x71
+#define FIFO_R_W     0x72
 #define REG_BANK_SEL 0x7F 			// write to this register to select a register bank
 
+#define IMU_DATA_LEN 14 			// ACCEL_XOUT_H through TEMP_OUT_L, read as a single burst
+#define IMU_MAG_DATA_LEN (IMU_DATA_LEN + MAG_DATA_LEN)	// the same burst extended into EXT_SLV_SENS_DATA_00
+#define IMU_MAX_DATA_LEN IMU_MAG_DATA_LEN
+#define IMU_BASE_ODR 1125.0f 		// [Hz] output data rate with the sample rate dividers at their reset value (0)
+#define ACCEL_BASE_ODR IMU_BASE_ODR
+#define GYRO_BASE_ODR  1100.0f 		// [Hz] the gyroscope divides 1.1 kHz rather than 1.125 kHz
+#define TEMP_SENS    333.87f 		// [LSB/degC]
+#define TEMP_ROOM    21.0f 			// reads 21 LSB at 21 degC (see toCelsius())
+
+/* FIFO */
+#define FIFO_SIZE         4096 		// bytes
+#define FIFO_PACKET_LEN   12 			// accelerometer + gyroscope, same layout as the data registers
+#define FIFO_TEMP_LEN     2 			// appended to each packet when the temperature is queued too
+#define FIFO_COUNT_BM     0x1FFF 		// FIFO_COUNTH[4:0]:FIFO_COUNTL
+
 /* User Bank Register 2 definitions */
-#define GYRO_CONFIG_1  0x01 		// used to find sensitivity of Gyroscope
-#define ACCEL_CONFIG_1 0x14 		// used to find sensitivity of acceleration
+#define GYRO_SMPLRT_DIV    0x00 	// gyroscope ODR = 1.1 kHz / (1 + GYRO_SMPLRT_DIV)
+#define GYRO_CONFIG_1      0x01 	// used to find sensitivity of Gyroscope
+#define ACCEL_SMPLRT_DIV_1 0x10 	// accelerometer ODR = 1.125 kHz / (1 + ACCEL_SMPLRT_DIV[11:0]), MSBs
+#define ACCEL_SMPLRT_DIV_2 0x11 	// LSBs
+#define ACCEL_CONFIG_1     0x14 	// used to find sensitivity of acceleration
+
+/* User Bank Register 3 definitions */
+#define I2C_MST_CTRL  0x01
+#define I2C_SLV0_ADDR 0x03
+#define I2C_SLV0_REG  0x04
+#define I2C_SLV0_CTRL 0x05
+#define I2C_SLV4_ADDR 0x13
+#define I2C_SLV4_REG  0x14
+#define I2C_SLV4_CTRL 0x15
+#define I2C_SLV4_DO   0x16
+#define I2C_SLV4_DI   0x17
+
+/* AK09916 Magnetometer, behind the ICM20948's auxiliary I2C master */
+#define MAG_I2C_ADDR  0x0C
+#define MAG_WIA2      0x01 			// 0x09 by default
+#define MAG_HXL       0x11 			// HXL through HZH are little-endian, followed by TMPS and ST2
+#define MAG_ST2       0x18 			// must be read to release the data registers for the next measurement
+#define MAG_CNTL2     0x31
+#define MAG_CNTL3     0x32
+#define MAG_DEVICE_ID 0x09
+#define MAG_DATA_LEN  8 			// HXL through ST2
+#define MAG_SENS      (1.0f / 0.15f)	// [LSB/uT], fixed
+
+#define MAG_MODE_POWER_DOWN 0x00
+#define MAG_MODE_10HZ       0x02
+#define MAG_MODE_20HZ       0x04
+#define MAG_MODE_50HZ       0x06
+#define MAG_MODE_100HZ      0x08
 
 /* Sensitivity Definitions */
 #define ACCEL_SENS_2G  (0b00 << 1)
@@ -69,11 +135,53 @@
 #define GYRO_SENS_1000DPS (0b10 << 1)
 #define GYRO_SENS_2000DPS (0b11 << 1)
 
+/* Digital Low-Pass Filter Definitions (DLPFCFG, named after the 3dB bandwidth) */
+#define GYRO_DLPF_197HZ  0
+#define GYRO_DLPF_152HZ  1
+#define GYRO_DLPF_120HZ  2
+#define GYRO_DLPF_51HZ   3
+#define GYRO_DLPF_24HZ   4
+#define GYRO_DLPF_12HZ   5
+#define GYRO_DLPF_6HZ    6
+#define GYRO_DLPF_361HZ  7
+
+#define ACCEL_DLPF_246HZ 1
+#define ACCEL_DLPF_111HZ 2
+#define ACCEL_DLPF_50HZ  3
+#define ACCEL_DLPF_24HZ  4
+#define ACCEL_DLPF_12HZ  5
+#define ACCEL_DLPF_6HZ   6
+#define ACCEL_DLPF_473HZ 7
+
+#define DLPF_BYPASS      8 			// FCHOICE = 0: unfiltered at 9 kHz (gyroscope)/4.5 kHz (accelerometer), dividers ignored
+
+#define GYRO_BYPASS_ODR  9000.0f 	// [Hz]
+#define ACCEL_BYPASS_ODR 4500.0f 	// [Hz]
+#define GYRO_MAX_DIV     255
+#define ACCEL_MAX_DIV    4095
+
 /* Bitmasks */
 #define SENSITIVITY_BM (0b11 << 1) 		// both gyroscope and accelerometer use the same bitmask
+#define DLPFCFG_BM     (0b111 << 3) 	// GYRO_CONFIG_1/ACCEL_CONFIG_1, low-pass filter configuration
+#define FCHOICE_BM     (1 << 0) 		// GYRO_CONFIG_1/ACCEL_CONFIG_1, enables the low-pass filter and the divider
 #define INT_OSC_BM     (0b111 << 0) 	// use internal 20MHz oscillator (see PWR_MGMT_1, pp. 37)
 #define ACCEL_AXES_EN  (0b111 << 3)		// accelerometer axes enable bits
 #define GYRO_AXES_EN   (0b111 << 0)		// gyroscope axes enable bits
+#define INT1_ACTL_BM   (1 << 7) 		// INT_PIN_CFG, INT1 is active low
+#define INT1_LATCH_BM  (1 << 5) 		// INT_PIN_CFG, INT1 is held until cleared instead of a 50us pulse
+#define RAW_DATA_RDY_EN (1 << 0) 		// INT_ENABLE_1, raw data ready interrupt
+#define FIFO_EN_BM     (1 << 6) 		// USER_CTRL, enables the FIFO
+#define I2C_MST_EN_BM  (1 << 5) 		// USER_CTRL, enables the auxiliary I2C master
+#define I2C_MST_CLK    0x07 			// I2C_MST_CTRL, 345.6 kHz, the recommended master clock
+#define SLV_READ       (1 << 7) 		// I2C_SLVx_ADDR, read transfer
+#define SLV_EN         (1 << 7) 		// I2C_SLVx_CTRL, enables the slave transfer
+#define SLV4_DONE_BM   (1 << 6) 		// I2C_MST_STATUS, the SLV4 transfer completed
+#define SLV4_NACK_BM   (1 << 4) 		// I2C_MST_STATUS, the SLV4 transfer was not acknowledged
+#define MAG_SRST       (1 << 0) 		// MAG_CNTL3, soft reset
+#define ACCEL_FIFO_EN  (1 << 4)			// FIFO_EN_2, accelerometer X, Y and Z
+#define GYRO_FIFO_EN   (0b111 << 1)		// FIFO_EN_2, gyroscope X, Y and Z
+#define TEMP_FIFO_EN   (1 << 0)			// FIFO_EN_2, temperature
+#define FIFO_ALL_BM    (0b11111 << 0) 	// FIFO_RST, FIFO_MODE, INT_ENABLE_2 and INT_STATUS_2 (one bit per FIFO)
 
 /* Miscellaneous */
 #define ACCEL_ALL_AXES_ON (0b000 << 3)
@@ -85,12 +193,42 @@ class ICM20948 {
 private:
 	I2C_Functions i2c;
 
+	/* Register Shadow Cache (see invalidateCache()) */
+	uint8_t currentBank;				// last value written to REG_BANK_SEL
+	int accConfig, gyroConfig;			// last known ACCEL_CONFIG_1/GYRO_CONFIG_1, -1 when unknown
+	int accDiv, gyroDiv;				// last known sample rate dividers, -1 when unknown
+	int readConfig(uint8_t reg, int& shadow);	// the shadow, read from the device if unknown; -1 on a bus error
+	int writeConfig(uint8_t reg, int& shadow, uint8_t mask, uint8_t value);
+	int readDividers();					// -1 on a bus error, the unread dividers stay unknown
+
 	void selectBankReg(uint8_t bank);
+	int readIMUBurst(uint8_t* raw);		// getDataLen() bytes starting at ACCEL_XOUT_H, zeroed and -1 on error
+	uint32_t readErrors;
+	static int16_t toInt16(const uint8_t* raw) { return (int16_t)(((uint16_t)raw[0] << 8) | raw[1]); }	// big-endian pair
+	static int16_t toInt16LE(const uint8_t* raw) { return (int16_t)(((uint16_t)raw[1] << 8) | raw[0]); }	// AK09916 order
+
+	/* Magnetometer */
+	bool magEnabled;					// the burst read also covers the auto-read magnetometer data
+	int magWrite(uint8_t reg, uint8_t data);
+	int magRead(uint8_t reg, uint8_t& data);
+	int waitSLV4();
+
+	/* FIFO Streaming */
+	int fifoPacketLen;					// bytes per FIFO packet, 0 while streaming is disabled
+	uint32_t fifoOverflows;
+	std::vector<uint8_t> fifoBuf;
+	SampleClock fifoClock;				// reconstructs the time of every packet
+	uint64_t fifoIndex;					// packets drained since the FIFO was last reset
+	std::vector<uint64_t> fifoTimes;	// times of the packets in fifoBuf
+	int drainFIFO(int max_samples);
 
     /* Debug Functions */
     bool debug;
-    void printe(std::string str) { if (debug) std::cout << "ERROR: " << str << " (ICM20948.cpp)" << std::endl; }
-	void printi(std::string str) { if (debug) std::cout << "INFO: " << str << " (ICM20948.cpp)" << std::endl; }
+    /* format strings are literals with integer arguments only, see Trace.h */
+    template <typename... Args>
+    void printe(const char* format, Args... args) { TRACE_ERROR(format, args...); if (debug) trace_console("ERROR", "ICM20948.cpp", format, args...); }
+    template <typename... Args>
+    void printi(const char* format, Args... args) { TRACE_INFO(format, args...); if (debug) trace_console("INFO", "ICM20948.cpp", format, args...); }
 
 public:
 	struct acc_t {
@@ -105,15 +243,51 @@ public:
     	float ax, ay, az;
     	float gx, gy, gz;
     	float temperature;
+    	float mx, my, mz;				// [uT] in the accelerometer's axes, 0 unless the magnetometer is enabled
+    	uint64_t timestamp;				// CLOCK_MONOTONIC [ns] at which the sample was read, 0 if unknown or the read failed
+	};
+
+	/* one array per channel, see IMU_Convert.h; a NULL temperature array is skipped */
+	struct soa_t {
+		float* ax; float* ay; float* az;
+		float* gx; float* gy; float* gz;
+		float* temperature;
+		uint64_t* timestamp;			// filled by readFIFO() only, may be NULL
 	};
 
+	/* register counts as read from the device, scale with getAccSens()/getGyroSens() */
+	struct raw_t {
+		int16_t ax, ay, az;
+		int16_t gx, gy, gz;
+		int16_t temperature;
+		int16_t mx, my, mz;				// AK09916 counts in its own axes (X, -Y, -Z of the accelerometer), 0 without it
+		uint64_t timestamp;				// CLOCK_MONOTONIC [ns] at which the sample was read, 0 if unknown or the read failed
+	};
+
+	static float toCelsius(int16_t raw) { return ((float)raw - TEMP_ROOM) / TEMP_SENS + TEMP_ROOM; }
+
+	static uint64_t monotonicTime() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+
 	explicit ICM20948(bool debug = false, uint8_t bus = 2, uint8_t address = IMU_I2C_ADDR);
+	void decodeIMUData(const uint8_t* raw, bool temperature, imu_t& imu, bool mag = false);	// data register/FIFO packet layout
+	void decodeRawData(const uint8_t* raw, bool temperature, raw_t& sample, bool mag = false);
 	int disableSleep();
 	int enableSleep();
 	bool whoAmI();
+	uint8_t getDeviceID();				// WHO_AM_I
 	uint16_t getStatus();
+	void invalidateCache();				// forget all shadowed registers, e.g. after a device reset
+	void resync();						// invalidates the cache and reloads it from the device
 	float getTemperature();
-	ICM20948::imu_t getIMUData();
+	ICM20948::imu_t getIMUData();		// all zero with timestamp 0 if the bus read failed
+	ICM20948::raw_t getRawData();		// same
+	uint32_t getReadErrors();			// failed sample reads so far
+	int queueIMUData(I2C_Queue& queue, uint8_t* raw);	// adds the burst read to a batch, decode with decodeIMUData()
+	int getDataLen() { return magEnabled ? IMU_MAG_DATA_LEN : IMU_DATA_LEN; }	// bytes per burst read
 
 	/* accelerometer */
 	ICM20948::acc_t getAccData();
@@ -124,6 +298,36 @@ public:
 	ICM20948::gyro_t getGyroData();
 	float getGyroSens();
 	int setGyroSens(uint8_t scale);
+
+	/* output data rate and bandwidth */
+	float setAccRate(float rate);		// [Hz] nearest rate the divider can produce, returns it or -1
+	float setGyroRate(float rate);
+	float getAccRate();					// effective rate, accounting for the divider and DLPF_BYPASS; -1 if unreadable
+	float getGyroRate();
+	float getDataRate();				// rate at which the data registers change, i.e. the useful polling rate
+	int setAccDLPF(uint8_t dlpf);		// ACCEL_DLPF_* or DLPF_BYPASS
+	int setGyroDLPF(uint8_t dlpf);		// GYRO_DLPF_* or DLPF_BYPASS
+	float getAccBandwidth();			// [Hz] 3dB bandwidth of the current filter
+	float getGyroBandwidth();
+
+	/* magnetometer */
+	int enableMag(uint8_t mode = MAG_MODE_100HZ);
+	int disableMag();
+	bool isMagEnabled() { return magEnabled; }
+
+	/* data ready interrupt */
+	int enableDataReadyInterrupt();
+	int disableDataReadyInterrupt();
+
+	/* FIFO streaming */
+	int enableFIFO(bool temperature = true);
+	int disableFIFO();
+	int resetFIFO();
+	int getFIFOCount();
+	int readFIFO(imu_t* samples, int max_samples);	// returns the number of samples drained, -1 on error
+	int readFIFO(soa_t samples, int max_samples);	// same, batch converted into arrays of at least 'max_samples'
+	uint32_t getFIFOOverflows();
+	SampleClock::stats_t getFIFOClockStats();	// fitted period, drift and read jitter of the FIFO timestamps
 };
 
 #endif	// ICM20948_H
\ No newline at end of file
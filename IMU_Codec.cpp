@@ -0,0 +1,259 @@
+/****************************************************************************
+ * IMU_Codec.cpp
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Lossless delta compression of raw IMU samples, varint or
+ *              bit-packed.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#include <string.h>
+#include "IMU_Codec.h"
+
+
+/********************************* Varints **********************************/
+
+/* zigzag maps small magnitudes of either sign to small unsigned values: 0, -1, 1, -2 ... -> 0, 1, 2, 3 ... */
+static inline uint64_t zigzag64(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static inline int64_t unzigzag64(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+static inline uint16_t zigzag16(int16_t v) { return (uint16_t)(((uint16_t)v << 1) ^ (uint16_t)(v >> 15)); }
+static inline int16_t unzigzag16(uint16_t v) { return (int16_t)((v >> 1) ^ -(int16_t)(v & 1)); }
+
+static inline uint8_t* putVarint(uint8_t* out, uint64_t v) {
+	while (v >= 0x80) {
+		*out++ = (uint8_t)(v | 0x80);
+		v >>= 7;
+	}
+	*out++ = (uint8_t)v;
+	return out;
+}
+
+static inline const uint8_t* getVarint(const uint8_t* in, const uint8_t* end, uint64_t& v) {
+	v = 0;
+	for (int shift = 0; in < end && shift < 64; shift += 7) {
+		uint8_t byte = *in++;
+		v |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) return in;
+	}
+	return NULL;		// truncated or overlong
+}
+
+/* bit-packed fields, LSB first; a field of width 0 takes no space and reads back as 0 */
+struct BitWriter {
+	uint8_t* out;
+	uint64_t acc;
+	int bits;
+
+	explicit BitWriter(uint8_t* out) : out(out), acc(0), bits(0) {}
+
+	void put(uint64_t v, int width) {
+		while (width > 0) {
+			int take = (width > 32) ? 32 : width;
+			acc |= (v & ((1ULL << take) - 1)) << bits;
+			bits += take;
+			v >>= take;
+			width -= take;
+			for (; bits >= 8; bits -= 8, acc >>= 8) *out++ = (uint8_t)acc;
+		}
+	}
+
+	uint8_t* flush() {
+		if (bits > 0) *out++ = (uint8_t)acc;
+		acc = 0;
+		bits = 0;
+		return out;
+	}
+};
+
+struct BitReader {
+	const uint8_t* in;
+	const uint8_t* end;
+	uint64_t acc;
+	int bits;
+
+	BitReader(const uint8_t* in, const uint8_t* end) : in(in), end(end), acc(0), bits(0) {}
+
+	uint64_t get(int width) {
+		uint64_t v = 0;
+		for (int done = 0; done < width;) {
+			int take = (width - done > 32) ? 32 : width - done;
+			for (; bits < take && in < end; bits += 8) acc |= (uint64_t)*in++ << bits;
+			v |= (acc & ((1ULL << take) - 1)) << done;		// the caller checked the length, no reads past 'end'
+			acc >>= take;
+			bits -= take;
+			done += take;
+		}
+		return v;
+	}
+};
+
+static inline int bitWidth(uint64_t v) {
+	return (v == 0) ? 0 : 64 - __builtin_clzll(v);
+}
+
+static inline void putLE(uint8_t* out, uint64_t v, int bytes) {
+	for (int i = 0; i < bytes; i++) out[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint64_t getLE(const uint8_t* in, int bytes) {
+	uint64_t v = 0;
+	for (int i = 0; i < bytes; i++) v |= (uint64_t)in[i] << (8 * i);
+	return v;
+}
+
+
+/******************************* DeltaEncoder *******************************/
+
+DeltaEncoder::DeltaEncoder(bool packed) {
+	this->packed = packed;
+	reset();
+}
+
+void DeltaEncoder::reset() {
+	memcpy(block, CODEC_SYNC, CODEC_SYNC_LEN);
+	len = CODEC_BLOCK_HEADER;
+	count = 0;
+	prevDelta = 0;
+}
+
+void DeltaEncoder::encode(const ICM20948::raw_t& sample) {
+	if (isFull()) return;
+
+	const int16_t cur[7] = {sample.ax, sample.ay, sample.az, sample.gx, sample.gy, sample.gz, sample.temperature};
+	uint8_t* out = &block[len];
+
+	if (count == 0) {
+		/* keyframe, stored verbatim so decoding can start here */
+		putLE(out, sample.timestamp, 8);
+		for (int i = 0; i < 7; i++) putLE(&out[8 + 2 * i], (uint16_t)cur[i], 2);
+		out += CODEC_KEYFRAME_LEN;
+	} else {
+		const int16_t old[7] = {prev.ax, prev.ay, prev.az, prev.gx, prev.gy, prev.gz, prev.temperature};
+		int64_t delta = (int64_t)(sample.timestamp - prev.timestamp);
+		if (packed) {
+			timeDeltas[count - 1] = zigzag64(delta - prevDelta);
+			for (int i = 0; i < 7; i++) channelDeltas[count - 1][i] = zigzag16((int16_t)(uint16_t)(cur[i] - old[i]));
+		} else {
+			out = putVarint(out, zigzag64(delta - prevDelta));
+			for (int i = 0; i < 7; i++) out = putVarint(out, zigzag16((int16_t)(uint16_t)(cur[i] - old[i])));
+		}
+		prevDelta = delta;
+	}
+
+	len = out - block;
+	prev = sample;
+	count++;
+}
+
+/* writes the widths and the packed records after the keyframe; len is recomputed, so finish() can be repeated */
+void DeltaEncoder::pack() {
+	int records = count - 1;
+	uint64_t timeBits = 0;
+	uint16_t channelBits[7] = {0, 0, 0, 0, 0, 0, 0};
+	for (int r = 0; r < records; r++) {
+		if (r > 0) timeBits |= timeDeltas[r];
+		for (int i = 0; i < 7; i++) channelBits[i] |= channelDeltas[r][i];
+	}
+
+	uint8_t* widths = &block[CODEC_BLOCK_HEADER + CODEC_KEYFRAME_LEN];
+	widths[0] = (uint8_t)bitWidth(timeBits);
+	for (int i = 0; i < 7; i++) widths[1 + i] = (uint8_t)bitWidth(channelBits[i]);
+
+	/* the first timestamp delta is a whole period rather than a delta-of-delta, it would set the width of every record */
+	uint8_t* out = widths + CODEC_PACK_WIDTHS;
+	if (records > 0) out = putVarint(out, timeDeltas[0]);
+
+	BitWriter writer(out);
+	for (int r = 0; r < records; r++) {
+		if (r > 0) writer.put(timeDeltas[r], widths[0]);
+		for (int i = 0; i < 7; i++) writer.put(channelDeltas[r][i], widths[1 + i]);
+	}
+	len = writer.flush() - block;
+}
+
+const uint8_t* DeltaEncoder::finish(size_t& block_len) {
+	if (packed && count > 0) pack();
+	putLE(&block[4], len - CODEC_BLOCK_HEADER, 4);
+	putLE(&block[8], count, 2);
+	block_len = len;
+	return block;
+}
+
+
+/******************************* Block Decoding *****************************/
+
+bool parseBlockHeader(const uint8_t* header, uint32_t& payload_len, uint16_t& count) {
+	if (memcmp(header, CODEC_SYNC, CODEC_SYNC_LEN) != 0) return false;
+
+	payload_len = (uint32_t)getLE(&header[4], 4);
+	count = (uint16_t)getLE(&header[8], 2);
+	return count > 0 && payload_len >= CODEC_KEYFRAME_LEN;
+}
+
+int decodeBlock(const uint8_t* payload, size_t payload_len, uint16_t count, ICM20948::raw_t* samples, int max_samples,
+                bool packed) {
+	const uint8_t* in = payload;
+	const uint8_t* end = payload + payload_len;
+	if (payload_len < CODEC_KEYFRAME_LEN || max_samples < 1) return -1;
+
+	int16_t cur[7];
+	uint64_t timestamp = getLE(in, 8);
+	for (int i = 0; i < 7; i++) cur[i] = (int16_t)getLE(&in[8 + 2 * i], 2);
+	in += CODEC_KEYFRAME_LEN;
+
+	/* packed records have a fixed size, so the whole block is checked against the payload length up front */
+	uint8_t widths[CODEC_PACK_WIDTHS];
+	uint64_t firstDelta = 0;
+	if (packed) {
+		if ((size_t)(end - in) < CODEC_PACK_WIDTHS) return -1;
+		memcpy(widths, in, CODEC_PACK_WIDTHS);
+		in += CODEC_PACK_WIDTHS;
+
+		uint64_t channelBits = 0;
+		if (widths[0] > 64) return -1;
+		for (int i = 1; i < CODEC_PACK_WIDTHS; i++) {
+			if (widths[i] > 16) return -1;
+			channelBits += widths[i];
+		}
+
+		uint64_t records = (count > 1) ? count - 1 : 0;
+		if (records > 0 && (in = getVarint(in, end, firstDelta)) == NULL) return -1;
+		if ((channelBits * records + widths[0] * (records > 0 ? records - 1 : 0) + 7) / 8 > (uint64_t)(end - in)) return -1;
+	}
+	BitReader reader(in, end);
+
+	int64_t delta = 0;
+	int n = 0;
+	while (true) {
+		ICM20948::raw_t& s = samples[n++];
+		s.ax = cur[0]; s.ay = cur[1]; s.az = cur[2];
+		s.gx = cur[3]; s.gy = cur[4]; s.gz = cur[5];
+		s.temperature = cur[6];
+		s.timestamp = timestamp;
+		if (n >= count || n >= max_samples) break;
+
+		uint64_t v;
+		if (packed) {
+			delta += unzigzag64((n == 1) ? firstDelta : reader.get(widths[0]));
+			timestamp += delta;
+			for (int i = 0; i < 7; i++) cur[i] = (int16_t)(uint16_t)(cur[i] + unzigzag16((uint16_t)reader.get(widths[1 + i])));
+			continue;
+		}
+
+		if ((in = getVarint(in, end, v)) == NULL) return -1;
+		delta += unzigzag64(v);
+		timestamp += delta;
+		for (int i = 0; i < 7; i++) {
+			if ((in = getVarint(in, end, v)) == NULL || v > UINT16_MAX) return -1;
+			cur[i] = (int16_t)(uint16_t)(cur[i] + unzigzag16((uint16_t)v));
+		}
+	}
+
+	return n;
+}
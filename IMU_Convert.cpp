@@ -0,0 +1,233 @@
+/****************************************************************************
+ * IMU_Convert.cpp
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Batch conversion of raw samples into scaled float arrays.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#include <string.h>
+#include "IMU_Convert.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CONVERT_NEON
+#endif
+
+
+#define CONVERT_CHANNELS 7 			// ax, ay, az, gx, gy, gz, temperature: the first 14 bytes of every sample
+
+struct kernel_t {
+	float scale[CONVERT_CHANNELS];
+	float offset[CONVERT_CHANNELS];
+	float* out[CONVERT_CHANNELS];	// NULL channels are skipped
+};
+
+/*
+ * Every kernel loads 16 bytes per sample (the 7 channels and 2 bytes of whatever follows), so it stops while the
+ * last of its samples still has 16 readable bytes and returns how many it converted; the scalar loop does the rest.
+ */
+static inline bool canLoad(size_t last, size_t stride, size_t count) {
+	return last < count && last * stride + 16 <= count * stride;
+}
+
+
+/********************************** Scalar **********************************/
+
+static void convertScalar(const uint8_t* data, size_t stride, size_t first, size_t count, bool swap, const kernel_t& k) {
+	for (size_t i = first; i < count; i++) {
+		const uint8_t* sample = data + i * stride;
+		for (int c = 0; c < CONVERT_CHANNELS; c++) {
+			if (k.out[c] == NULL) continue;
+
+			int16_t value;
+			if (swap) {
+				value = (int16_t)(((uint16_t)sample[2 * c] << 8) | sample[2 * c + 1]);
+			} else {
+				memcpy(&value, &sample[2 * c], sizeof(value));
+			}
+			k.out[c][i] = (float)value * k.scale[c] + k.offset[c];
+		}
+	}
+}
+
+
+/*********************************** SSE2 ***********************************/
+
+#ifdef __SSE2__
+static size_t convertSSE2(const uint8_t* data, size_t stride, size_t count, bool swap, const kernel_t& k) {
+	__m128 scale[CONVERT_CHANNELS], offset[CONVERT_CHANNELS];
+	for (int c = 0; c < CONVERT_CHANNELS; c++) {
+		scale[c] = _mm_set1_ps(k.scale[c]);
+		offset[c] = _mm_set1_ps(k.offset[c]);
+	}
+
+	size_t i = 0;
+	for (; canLoad(i + 3, stride, count); i += 4) {
+		__m128i v[4];
+		for (int s = 0; s < 4; s++) {
+			v[s] = _mm_loadu_si128((const __m128i*)(data + (i + s) * stride));
+			if (swap) v[s] = _mm_or_si128(_mm_slli_epi16(v[s], 8), _mm_srli_epi16(v[s], 8));
+		}
+
+		/* transpose: u[c / 2] holds channel c of the 4 samples in its low half and channel c + 1 in its high half */
+		__m128i t0 = _mm_unpacklo_epi16(v[0], v[1]), t1 = _mm_unpacklo_epi16(v[2], v[3]);
+		__m128i t2 = _mm_unpackhi_epi16(v[0], v[1]), t3 = _mm_unpackhi_epi16(v[2], v[3]);
+		__m128i u[4] = {_mm_unpacklo_epi32(t0, t1), _mm_unpackhi_epi32(t0, t1),
+						_mm_unpacklo_epi32(t2, t3), _mm_unpackhi_epi32(t2, t3)};
+
+		for (int c = 0; c < CONVERT_CHANNELS; c++) {
+			if (k.out[c] == NULL) continue;
+
+			__m128i w = (c & 1) ? _mm_unpackhi_epi16(u[c / 2], u[c / 2]) : _mm_unpacklo_epi16(u[c / 2], u[c / 2]);
+			__m128 f = _mm_cvtepi32_ps(_mm_srai_epi32(w, 16));		// sign-extend
+			_mm_storeu_ps(k.out[c] + i, _mm_add_ps(_mm_mul_ps(f, scale[c]), offset[c]));
+		}
+	}
+
+	return i;
+}
+#endif
+
+
+/*********************************** AVX2 ***********************************/
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CONVERT_AVX2
+
+/* same transpose as SSE2, with samples i..i+3 in the low 128-bit lane and i+4..i+7 in the high one */
+__attribute__((target("avx2")))
+static size_t convertAVX2(const uint8_t* data, size_t stride, size_t count, bool swap, const kernel_t& k) {
+	size_t i = 0;
+	for (; canLoad(i + 7, stride, count); i += 8) {
+		__m256i v[4];
+		for (int s = 0; s < 4; s++) {
+			__m128i lo = _mm_loadu_si128((const __m128i*)(data + (i + s) * stride));
+			__m128i hi = _mm_loadu_si128((const __m128i*)(data + (i + s + 4) * stride));
+			v[s] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+			if (swap) v[s] = _mm256_or_si256(_mm256_slli_epi16(v[s], 8), _mm256_srli_epi16(v[s], 8));
+		}
+
+		__m256i t0 = _mm256_unpacklo_epi16(v[0], v[1]), t1 = _mm256_unpacklo_epi16(v[2], v[3]);
+		__m256i t2 = _mm256_unpackhi_epi16(v[0], v[1]), t3 = _mm256_unpackhi_epi16(v[2], v[3]);
+		__m256i u[4] = {_mm256_unpacklo_epi32(t0, t1), _mm256_unpackhi_epi32(t0, t1),
+						_mm256_unpacklo_epi32(t2, t3), _mm256_unpackhi_epi32(t2, t3)};
+
+		for (int c = 0; c < CONVERT_CHANNELS; c++) {
+			if (k.out[c] == NULL) continue;
+
+			__m256i w = (c & 1) ? _mm256_unpackhi_epi16(u[c / 2], u[c / 2]) : _mm256_unpacklo_epi16(u[c / 2], u[c / 2]);
+			__m256 f = _mm256_cvtepi32_ps(_mm256_srai_epi32(w, 16));
+			__m256 scaled = _mm256_add_ps(_mm256_mul_ps(f, _mm256_set1_ps(k.scale[c])), _mm256_set1_ps(k.offset[c]));
+			_mm256_storeu_ps(k.out[c] + i, scaled);
+		}
+	}
+
+	return i;
+}
+#endif
+
+
+/*********************************** NEON ***********************************/
+
+#ifdef CONVERT_NEON
+static size_t convertNEON(const uint8_t* data, size_t stride, size_t count, bool swap, const kernel_t& k) {
+	size_t i = 0;
+	for (; canLoad(i + 3, stride, count); i += 4) {
+		int16x8_t v[4];
+		for (int s = 0; s < 4; s++) {
+			uint8x16_t bytes = vld1q_u8(data + (i + s) * stride);
+			if (swap) bytes = vrev16q_u8(bytes);
+			v[s] = vreinterpretq_s16_u8(bytes);
+		}
+
+		int16x8x2_t t01 = vzipq_s16(v[0], v[1]);
+		int16x8x2_t t23 = vzipq_s16(v[2], v[3]);
+		int32x4x2_t lo = vzipq_s32(vreinterpretq_s32_s16(t01.val[0]), vreinterpretq_s32_s16(t23.val[0]));
+		int32x4x2_t hi = vzipq_s32(vreinterpretq_s32_s16(t01.val[1]), vreinterpretq_s32_s16(t23.val[1]));
+		int16x8_t u[4] = {vreinterpretq_s16_s32(lo.val[0]), vreinterpretq_s16_s32(lo.val[1]),
+						  vreinterpretq_s16_s32(hi.val[0]), vreinterpretq_s16_s32(hi.val[1])};
+
+		for (int c = 0; c < CONVERT_CHANNELS; c++) {
+			if (k.out[c] == NULL) continue;
+
+			int16x4_t w = (c & 1) ? vget_high_s16(u[c / 2]) : vget_low_s16(u[c / 2]);
+			float32x4_t f = vcvtq_f32_s32(vmovl_s16(w));
+			vst1q_f32(k.out[c] + i, vmlaq_f32(vdupq_n_f32(k.offset[c]), f, vdupq_n_f32(k.scale[c])));
+		}
+	}
+
+	return i;
+}
+#endif
+
+
+/******************************** Dispatch **********************************/
+
+typedef size_t (*kernel_fn)(const uint8_t*, size_t, size_t, bool, const kernel_t&);
+
+static kernel_fn selectKernel(const char** name) {
+#ifdef CONVERT_AVX2
+	__builtin_cpu_init();			// runs from a static initializer, possibly before libgcc's own
+	if (__builtin_cpu_supports("avx2")) {
+		*name = "avx2";
+		return convertAVX2;
+	}
+#endif
+#ifdef __SSE2__
+	*name = "sse2";
+	return convertSSE2;
+#elif defined(CONVERT_NEON)
+	*name = "neon";
+	return convertNEON;
+#else
+	*name = "scalar";
+	return NULL;
+#endif
+}
+
+static const char* kernelName;
+static const kernel_fn kernel = selectKernel(&kernelName);
+
+static void convert(const uint8_t* data, size_t stride, size_t count, bool swap, float acc_sens, float gyro_sens,
+					ICM20948::soa_t out) {
+	kernel_t k;
+	for (int c = 0; c < 3; c++) {
+		k.scale[c] = 1.0f / acc_sens;
+		k.scale[c + 3] = 1.0f / gyro_sens;
+	}
+	k.scale[6] = 1.0f / TEMP_SENS;
+	for (int c = 0; c < 6; c++) k.offset[c] = 0.0f;
+	k.offset[6] = TEMP_ROOM - TEMP_ROOM / TEMP_SENS;		// toCelsius() folded into a multiply-add
+
+	float* outputs[CONVERT_CHANNELS] = {out.ax, out.ay, out.az, out.gx, out.gy, out.gz, out.temperature};
+	memcpy(k.out, outputs, sizeof(outputs));
+
+	size_t done = (kernel != NULL) ? kernel(data, stride, count, swap, k) : 0;
+	convertScalar(data, stride, done, count, swap, k);
+}
+
+void convertPackets(const uint8_t* packets, size_t stride, size_t count, float acc_sens, float gyro_sens,
+					ICM20948::soa_t out) {
+	convert(packets, stride, count, true, acc_sens, gyro_sens, out);
+}
+
+void convertSamples(const ICM20948::raw_t* samples, size_t count, float acc_sens, float gyro_sens, ICM20948::soa_t out) {
+	/* ax through temperature are the leading int16 members of raw_t, already in host order */
+	static_assert(offsetof(ICM20948::raw_t, temperature) == 2 * (CONVERT_CHANNELS - 1), "raw_t layout changed");
+	static_assert(sizeof(ICM20948::raw_t) >= 16, "kernels load 16 bytes per sample");
+	convert((const uint8_t*)samples, sizeof(ICM20948::raw_t), count, false, acc_sens, gyro_sens, out);
+}
+
+const char* getConvertKernel() {
+	return kernelName;
+}
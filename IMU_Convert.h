@@ -0,0 +1,42 @@
+/****************************************************************************
+ * IMU_Convert.h
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Batch conversion of raw samples into scaled float arrays.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#ifndef IMU_CONVERT_H
+#define IMU_CONVERT_H
+
+/********************************* Includes *********************************/
+#include <stdint.h>
+#include <stddef.h>
+#include "ICM20948.h"
+
+/******************************** Conversion ********************************/
+/*
+ * Both kernels write one array per channel (structure of arrays), scaled to g, dps and degC, in a single pass. The
+ * sensitivities are turned into reciprocals once per batch, so each value costs a multiply instead of a divide, and
+ * four (SSE2/NEON) or eight (AVX2) samples are converted per step. A NULL 'out.temperature' skips that channel.
+ *
+ * AVX2 is picked at run time on x86; NEON is used when the compiler targets it (always on AArch64, -mfpu=neon on
+ * ARMv7). Anything else runs the scalar loop.
+ */
+
+/* 'count' packets in the data register/FIFO layout (big-endian, stride >= FIFO_PACKET_LEN bytes apart) */
+void convertPackets(const uint8_t* packets, size_t stride, size_t count, float acc_sens, float gyro_sens,
+					ICM20948::soa_t out);
+
+/* samples from getRawData() or IMULogReader */
+void convertSamples(const ICM20948::raw_t* samples, size_t count, float acc_sens, float gyro_sens, ICM20948::soa_t out);
+
+const char* getConvertKernel();		// "avx2", "sse2", "neon" or "scalar"
+
+#endif	// IMU_CONVERT_H
@@ -0,0 +1,330 @@
+/****************************************************************************
+ * IMU_Log.cpp
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Compact binary recording format for raw IMU samples.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include "IMU_Log.h"
+
+
+/* writes all of 'len' bytes, retrying short writes */
+static int writeAll(int fd, const uint8_t* data, size_t len) {
+	while (len > 0) {
+		ssize_t written = ::write(fd, data, len);
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		data += written;
+		len -= written;
+	}
+
+	return 0;
+}
+
+
+/******************************* IMULogWriter *******************************/
+
+IMULogWriter::IMULogWriter() {
+	fd = -1;
+	used = 0;
+	dropped = 0;
+}
+
+IMULogWriter::~IMULogWriter() {
+	close();
+}
+
+imulog_header_t IMULogWriter::makeHeader(uint8_t device_id, float acc_sens, float gyro_sens, float odr, uint8_t encoding) {
+	imulog_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, IMULOG_MAGIC, IMULOG_MAGIC_LEN);
+	header.version = IMULOG_VERSION;
+	header.header_size = sizeof(imulog_header_t);
+	header.record_size = sizeof(imulog_record_t);
+	header.device_id = device_id;
+	header.encoding = encoding;
+	header.acc_sens = acc_sens;
+	header.gyro_sens = gyro_sens;
+	header.odr = odr;
+	header.start_time = ICM20948::monotonicTime();
+
+	return header;
+}
+
+/* common part of open() and openAsync() once the file exists */
+int IMULogWriter::start(const imulog_header_t& header) {
+	dropped = 0;
+	if (header.encoding == IMULOG_ENC_DELTA || header.encoding == IMULOG_ENC_PACKED) {
+		encoder.reset(new DeltaEncoder(header.encoding == IMULOG_ENC_PACKED));
+	} else if (header.encoding == IMULOG_ENC_RAW) {
+		encoder.reset();
+	} else {
+		return -1;
+	}
+
+	return emit(&header, sizeof(header), 0);
+}
+
+int IMULogWriter::open(std::string path, const imulog_header_t& header) {
+	close();
+
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) return -1;
+
+	buf.resize(IMULOG_BUFFER_SIZE);
+	used = 0;
+
+	return start(header);
+}
+
+int IMULogWriter::openAsync(std::string path, const imulog_header_t& header, async_policy_t policy, int sync_every) {
+	close();
+
+	async.reset(new AsyncWriter());
+	if (async->open(path, policy, sync_every) < 0 || start(header) < 0) {
+		async.reset();
+		return -1;
+	}
+
+	return 0;
+}
+
+/* hands 'len' bytes holding 'records' samples to the buffer or the AsyncWriter */
+int IMULogWriter::emit(const void* data, size_t len, int records) {
+	if (async) {
+		if (async->append(data, len) < 0) {
+			dropped += records;
+			return -1;
+		}
+		return 0;
+	}
+
+	if (used + len > buf.size() && drain() < 0) return -1;
+	if (len > buf.size()) return writeAll(fd, (const uint8_t*)data, len);
+	memcpy(&buf[used], data, len);
+	used += len;
+
+	return 0;
+}
+
+/* hands the local buffer to the kernel */
+int IMULogWriter::drain() {
+	int status = writeAll(fd, buf.data(), used);
+	used = 0;
+
+	return status;
+}
+
+int IMULogWriter::emitBlock() {
+	int count = encoder->getCount();
+	if (count == 0) return 0;
+
+	size_t len;
+	const uint8_t* data = encoder->finish(len);
+	int status = emit(data, len, count);
+	encoder->reset();
+
+	return status;
+}
+
+int IMULogWriter::write(const ICM20948::raw_t& sample) {
+	if (fd < 0 && !async) return -1;
+
+	if (encoder) {
+		encoder->encode(sample);
+		return encoder->isFull() ? emitBlock() : 0;
+	}
+
+	imulog_record_t record;
+	record.timestamp = sample.timestamp;
+	record.ax = sample.ax;
+	record.ay = sample.ay;
+	record.az = sample.az;
+	record.gx = sample.gx;
+	record.gy = sample.gy;
+	record.gz = sample.gz;
+	record.temperature = sample.temperature;
+
+	return emit(&record, sizeof(record), 1);
+}
+
+uint64_t IMULogWriter::getDroppedRecords() {
+	return dropped;
+}
+
+int IMULogWriter::flush() {
+	if (fd < 0 && !async) return -1;
+
+	int status = 0;
+	if (encoder && emitBlock() < 0) status = -1;
+	if (async) return (async->flush() < 0) ? -1 : status;
+
+	return (drain() < 0) ? -1 : status;
+}
+
+int IMULogWriter::close() {
+	if (fd < 0 && !async) return 0;
+
+	int status = flush();
+	if (async) {
+		if (async->close() < 0) status = -1;
+		async.reset();
+		return status;
+	}
+
+	if (::close(fd) < 0) status = -1;
+	fd = -1;
+
+	return status;
+}
+
+
+/******************************* IMULogReader *******************************/
+
+IMULogReader::IMULogReader() {
+	file = NULL;
+	blockPos = 0;
+	memset(&header, 0, sizeof(header));
+}
+
+IMULogReader::~IMULogReader() {
+	close();
+}
+
+int IMULogReader::open(std::string path) {
+	close();
+
+	file = fopen(path.c_str(), "rb");
+	if (file == NULL) return -1;
+
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, IMULOG_MAGIC, IMULOG_MAGIC_LEN) != 0 ||
+		header.version > IMULOG_VERSION || header.record_size < sizeof(imulog_record_t) ||
+		header.encoding > IMULOG_ENC_PACKED) {
+		close();
+		return -1;
+	}
+
+	/* newer writers may append fields to the header */
+	if (fseeko(file, header.header_size, SEEK_SET) < 0) {
+		close();
+		return -1;
+	}
+
+	block.clear();
+	blockPos = 0;
+
+	return 0;
+}
+
+/* decodes the delta block at the current file position, false at the end of the log or on a truncated block */
+bool IMULogReader::readBlock() {
+	uint8_t blockHeader[CODEC_BLOCK_HEADER];
+	uint32_t len;
+	uint16_t count;
+
+	block.clear();
+	blockPos = 0;
+	if (fread(blockHeader, sizeof(blockHeader), 1, file) != 1 || !parseBlockHeader(blockHeader, len, count)) return false;
+
+	/* never size the buffers from a corrupt header: no writer produces more than CODEC_MAX_BLOCK */
+	if (len > CODEC_MAX_BLOCK - CODEC_BLOCK_HEADER || count > CODEC_BLOCK_RECORDS) return false;
+
+	payload.resize(len);
+	block.resize(count);
+	if (fread(payload.data(), len, 1, file) != 1) {
+		block.clear();
+		return false;
+	}
+
+	int n = decodeBlock(payload.data(), len, count, block.data(), count, header.encoding == IMULOG_ENC_PACKED);
+	block.resize(n > 0 ? n : 0);
+
+	return n > 0;
+}
+
+bool IMULogReader::next(ICM20948::raw_t& sample) {
+	if (file == NULL) return false;
+
+	if (header.encoding != IMULOG_ENC_RAW) {
+		if (blockPos >= block.size() && !readBlock()) return false;
+		sample = block[blockPos++];
+		return true;
+	}
+
+	/* newer writers may append fields to the record, they are skipped */
+	imulog_record_t record;
+	if (fread(&record, sizeof(record), 1, file) != 1) return false;
+	if (header.record_size > sizeof(record) && fseeko(file, header.record_size - sizeof(record), SEEK_CUR) < 0) return false;
+
+	sample.timestamp = record.timestamp;
+	sample.ax = record.ax;
+	sample.ay = record.ay;
+	sample.az = record.az;
+	sample.gx = record.gx;
+	sample.gy = record.gy;
+	sample.gz = record.gz;
+	sample.temperature = record.temperature;
+
+	return true;
+}
+
+int IMULogReader::seekTime(uint64_t timestamp) {
+	if (file == NULL) return -1;
+
+	if (header.encoding == IMULOG_ENC_RAW) {
+		/* fixed size records, binary search for the first one at or after 'timestamp' */
+		if (fseeko(file, 0, SEEK_END) < 0) return -1;
+		off_t first = 0, last = (ftello(file) - header.header_size) / header.record_size;
+		while (first < last) {
+			off_t mid = first + (last - first) / 2;
+			uint64_t t;
+			if (fseeko(file, header.header_size + mid * header.record_size, SEEK_SET) < 0 ||
+				fread(&t, sizeof(t), 1, file) != 1) return -1;
+			if (t < timestamp) first = mid + 1;
+			else last = mid;
+		}
+		return fseeko(file, header.header_size + first * header.record_size, SEEK_SET);
+	}
+
+	/* hop from keyframe to keyframe and decode the last block starting at or before 'timestamp' */
+	off_t offset = header.header_size, target = offset;
+	while (true) {
+		uint8_t key[CODEC_BLOCK_HEADER + sizeof(uint64_t)];
+		uint32_t len;
+		uint16_t count;
+		if (fseeko(file, offset, SEEK_SET) < 0 || fread(key, sizeof(key), 1, file) != 1 ||
+			!parseBlockHeader(key, len, count)) break;
+
+		uint64_t t;
+		memcpy(&t, &key[CODEC_BLOCK_HEADER], sizeof(t));
+		if (t > timestamp) break;
+		target = offset;
+		offset += CODEC_BLOCK_HEADER + len;
+	}
+
+	if (fseeko(file, target, SEEK_SET) < 0) return -1;
+	if (!readBlock()) return 0;		// empty log, next() returns false
+	while (blockPos < block.size() && block[blockPos].timestamp < timestamp) blockPos++;
+
+	return 0;
+}
+
+void IMULogReader::close() {
+	if (file != NULL) fclose(file);
+	file = NULL;
+	block.clear();
+	blockPos = 0;
+}
@@ -0,0 +1,135 @@
+/****************************************************************************
+ * IMU_Log.h
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Compact binary recording format for raw IMU samples.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#ifndef IMU_LOG_H
+#define IMU_LOG_H
+
+/********************************* Includes *********************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <memory>
+#include <vector>
+#include "ICM20948.h"
+#include "AsyncWriter.h"
+#include "IMU_Codec.h"
+
+/********************************* Defines **********************************/
+/*
+ * File layout (all fields little-endian, as written by the ARM/x86 hosts this runs on):
+ *
+ *   imulog_header_t                     fixed size, see header_size
+ *   imulog_record_t * N                 IMULOG_ENC_RAW: one per sample, see record_size
+ *   delta blocks                        IMULOG_ENC_DELTA: keyframe + varint deltas, see IMU_Codec.h
+ *                                       IMULOG_ENC_PACKED: keyframe + bit-packed deltas, see IMU_Codec.h
+ *
+ * Either way a sample holds the register counts exactly as read from the device, so no precision is lost; divide by
+ * the sensitivities in the header to get g and dps (see log2csv.cpp).
+ */
+#define IMULOG_MAGIC        "ICMLOG\0\0"
+#define IMULOG_MAGIC_LEN    8
+#define IMULOG_VERSION      1
+#define IMULOG_BUFFER_SIZE  (64 * 1024) 		// bytes buffered by the writer between write() calls
+
+#define IMULOG_ENC_RAW      0 					// fixed size records, also what logs written before the field read as
+#define IMULOG_ENC_DELTA    1 					// 8 to 11 bytes per sample, against 22 raw
+#define IMULOG_ENC_PACKED   2 					// 5 to 9 bytes per sample, depending mostly on timestamp jitter
+
+#pragma pack(push, 1)
+struct imulog_header_t {
+	char magic[IMULOG_MAGIC_LEN];
+	uint16_t version;
+	uint16_t header_size;				// sizeof(imulog_header_t), lets readers skip fields they do not know
+	uint16_t record_size;				// sizeof(imulog_record_t)
+	uint8_t device_id;					// WHO_AM_I of the recorded sensor
+	uint8_t encoding;					// IMULOG_ENC_*
+	float acc_sens;						// [LSB/g]
+	float gyro_sens;					// [LSB/dps]
+	float odr;							// configured output data rate [Hz]
+	uint64_t start_time;				// CLOCK_MONOTONIC [ns] when the recording started
+};
+
+struct imulog_record_t {
+	uint64_t timestamp;					// CLOCK_MONOTONIC [ns]
+	int16_t ax, ay, az;
+	int16_t gx, gy, gz;
+	int16_t temperature;
+};
+#pragma pack(pop)
+
+/******************************* IMULogWriter *******************************/
+
+/*
+ * Appends records to a large in-memory buffer and hands it to the kernel in IMULOG_BUFFER_SIZE write() calls. Opened
+ * with openAsync(), the records go to an AsyncWriter instead, so the calling thread never waits for the disk. With
+ * IMULOG_ENC_DELTA or IMULOG_ENC_PACKED, samples are compressed inline and leave the writer one block
+ * (CODEC_BLOCK_RECORDS samples) at a time.
+ */
+class IMULogWriter {
+private:
+	int fd;
+	std::vector<uint8_t> buf;
+	size_t used;
+	std::unique_ptr<AsyncWriter> async;
+	std::unique_ptr<DeltaEncoder> encoder;
+	uint64_t dropped;
+
+	int start(const imulog_header_t& header);
+	int emit(const void* data, size_t len, int records);
+	int emitBlock();
+	int drain();
+
+public:
+	IMULogWriter();
+	~IMULogWriter();
+	IMULogWriter(const IMULogWriter&) = delete;
+	IMULogWriter& operator=(const IMULogWriter&) = delete;
+
+	static imulog_header_t makeHeader(uint8_t device_id, float acc_sens, float gyro_sens, float odr,
+									  uint8_t encoding = IMULOG_ENC_RAW);
+
+	int open(std::string path, const imulog_header_t& header);
+	int openAsync(std::string path, const imulog_header_t& header, async_policy_t policy = ASYNC_BLOCK, int sync_every = 0);
+	int write(const ICM20948::raw_t& sample);		// -1 if the record could not be written or was dropped
+	uint64_t getDroppedRecords();
+	int flush();									// also ends the current delta block early
+	int close();
+};
+
+/******************************* IMULogReader *******************************/
+
+class IMULogReader {
+private:
+	FILE* file;
+	imulog_header_t header;
+	std::vector<uint8_t> payload;
+	std::vector<ICM20948::raw_t> block;				// decoded delta block
+	size_t blockPos;
+
+	bool readBlock();
+
+public:
+	IMULogReader();
+	~IMULogReader();
+	IMULogReader(const IMULogReader&) = delete;
+	IMULogReader& operator=(const IMULogReader&) = delete;
+
+	int open(std::string path);
+	const imulog_header_t& getHeader() { return header; }
+	bool next(ICM20948::raw_t& sample);		// false at the end of the log
+	int seekTime(uint64_t timestamp);		// next() continues at the first sample at or after 'timestamp'
+	void close();
+};
+
+#endif	// IMU_LOG_H
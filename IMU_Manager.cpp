@@ -0,0 +1,189 @@
+/****************************************************************************
+ * IMU_Manager.cpp
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Samples several ICM20948s spread over one or more I2C buses.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#include <algorithm>
+#include "IMU_Manager.h"
+#include "Pacer.h"
+
+
+IMUManager::IMUManager(bool debug) : running(false) {
+	this->debug = debug;
+}
+
+IMUManager::~IMUManager() {
+	stop();
+}
+
+int IMUManager::addIMU(uint8_t bus, uint8_t address) {
+	if (running) {
+		printe("IMUs cannot be added while sampling.");
+		return -1;
+	}
+
+	/* same bring-up as IMU::IMU() */
+	int status = 0;
+	std::unique_ptr<ICM20948> imu(new ICM20948(debug, bus, address));
+	status += imu->setAccSens(ACCEL_SENS_4G);
+	status += imu->setGyroSens(GYRO_SENS_500DPS);
+	status += imu->disableSleep();
+	if (status < 0) {
+		printe("IMU could not be initialized.");
+		return -1;
+	}
+
+	int device = imus.size();
+	imus.push_back(std::move(imu));
+
+	worker_t* worker = NULL;
+	for (size_t i = 0; i < workers.size(); i++) {
+		if (workers[i]->bus == bus) worker = workers[i].get();
+	}
+	if (worker == NULL) {
+		workers.emplace_back(new worker_t());
+		worker = workers.back().get();
+		worker->bus = bus;
+	}
+	worker->devices.push_back(device);
+
+	return device;
+}
+
+int IMUManager::getIMUCount() {
+	return imus.size();
+}
+
+ICM20948* IMUManager::getIMU(int device) {
+	if (running) {
+		printe("IMUs cannot be configured while sampling, stop() first.");
+		return NULL;
+	}
+	if (device < 0 || device >= (int)imus.size()) return NULL;
+
+	return imus[device].get();
+}
+
+int IMUManager::start(size_t capacity) {
+	if (running) return 0;
+	if (imus.empty()) {
+		printe("No IMUs have been added.");
+		return -1;
+	}
+
+	merged.reserve(capacity * workers.size());
+	running = true;
+	for (size_t i = 0; i < workers.size(); i++) {
+		worker_t* worker = workers[i].get();
+		worker->ring.reset(new SPSCRing<sample_t>(capacity));
+		worker->dropped = 0;
+		worker->thread = std::thread(&IMUManager::workerLoop, this, worker);
+	}
+	printi("Started %d bus worker(s) for %d IMU(s).", (int)workers.size(), (int)imus.size());
+
+	return 0;
+}
+
+void IMUManager::stop() {
+	if (!running) return;
+
+	running = false;
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i]->thread.join();
+	}
+}
+
+void IMUManager::workerLoop(worker_t* worker) {
+	size_t n = worker->devices.size();
+	std::vector<uint8_t> raw(n * IMU_MAX_DATA_LEN);
+	std::vector<int> ops(n);
+
+	/* one round per sample of the fastest sensor on the bus, reading faster would only return the same samples */
+	float rate = 0;
+	for (size_t i = 0; i < n; i++) {
+		float deviceRate = imus[worker->devices[i]]->getDataRate();
+		if (deviceRate > rate) rate = deviceRate;
+	}
+	if (rate <= 0) {
+		rate = IMU_BASE_ODR;		// no rate could be read, poll at the fastest filtered rate rather than free-run the bus
+		printe("The data rate of the IMUs on bus %d could not be read, polling at %d Hz.", worker->bus, (int)rate);
+	}
+	Pacer pacer(rate);
+
+	while (running.load(std::memory_order_relaxed)) {
+		pacer.wait();
+
+		/* one ioctl reads every sensor on this bus; a queue holds up to 21 reads, larger buses are split */
+		size_t first = 0;
+		while (first < n) {
+			I2C_Queue queue;
+			size_t last = first;
+			while (last < n) {
+				ops[last] = imus[worker->devices[last]]->queueIMUData(queue, &raw[last * IMU_MAX_DATA_LEN]);
+				if (ops[last] < 0) break;
+				last++;
+			}
+			if (last == first) break;		// the sensor could not be queued at all
+
+			queue.submit();
+			uint64_t timestamp = ICM20948::monotonicTime();
+
+			for (size_t i = first; i < last; i++) {
+				if (queue.result(ops[i]) != 0) continue;
+
+				sample_t sample;
+				sample.device = worker->devices[i];
+				ICM20948* imu = imus[sample.device].get();
+				imu->decodeIMUData(&raw[i * IMU_MAX_DATA_LEN], true, sample.data, imu->isMagEnabled());
+				sample.data.timestamp = timestamp;
+				if (!worker->ring->push(sample)) worker->dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+			first = last;
+		}
+	}
+}
+
+/*
+ * Drains every bus ring and returns the samples ordered by timestamp. Ordering is guaranteed within one call; a bus
+ * that lags behind can still deliver an older sample in a later call.
+ */
+size_t IMUManager::popSamples(sample_t* samples, size_t max_samples) {
+	merged.clear();
+	merged.resize(max_samples);
+
+	/* every bus gets a fair share of 'max_samples' so a busy bus cannot starve the others */
+	size_t count = 0;
+	for (size_t i = 0; i < workers.size(); i++) {
+		if (!workers[i]->ring) continue;
+
+		size_t quota = (max_samples - count) / (workers.size() - i);
+		if (quota == 0 && count < max_samples) quota = 1;
+		count += workers[i]->ring->pop(&merged[count], quota);
+	}
+	merged.resize(count);
+
+	std::sort(merged.begin(), merged.end(), [](const sample_t& a, const sample_t& b) {
+		return a.data.timestamp < b.data.timestamp;
+	});
+	std::copy(merged.begin(), merged.end(), samples);
+
+	return count;
+}
+
+uint64_t IMUManager::getDroppedSamples() {
+	uint64_t dropped = 0;
+	for (size_t i = 0; i < workers.size(); i++) {
+		dropped += workers[i]->dropped.load(std::memory_order_relaxed);
+	}
+
+	return dropped;
+}
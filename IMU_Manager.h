@@ -0,0 +1,89 @@
+/****************************************************************************
+ * IMU_Manager.h
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Samples several ICM20948s spread over one or more I2C buses.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#ifndef IMU_MANAGER_H
+#define IMU_MANAGER_H
+
+/********************************* Includes *********************************/
+#include <stdio.h>
+#include <string>
+#include <iostream>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "ICM20948.h"
+#include "SampleRing.h"
+
+/********************************* Defines **********************************/
+#define MANAGER_CAPACITY 1024 		// default number of samples buffered per bus
+
+/******************************** IMUManager ********************************/
+
+/*
+ * Owns a set of ICM20948s and runs one acquisition thread per I2C bus. Buses progress in parallel, while the sensors
+ * sharing a bus are read back-to-back in a single I2C_RDWR ioctl (see I2C_Queue), so the aggregate rate scales with
+ * the number of buses rather than the number of sensors. Each bus thread feeds its own lock-free ring and
+ * popSamples() merges them into one stream ordered by timestamp.
+ *
+ * Each bus is polled once per sample of its fastest sensor, at the rate read when start() is called. Rates, filters
+ * and ranges are therefore configured through getIMU() before start(); while sampling, the bus threads own the
+ * sensors (their bank selection and register shadows included) and getIMU() is refused.
+ */
+class IMUManager {
+public:
+	struct sample_t {
+		int device;									// index returned by addIMU()
+		ICM20948::imu_t data;
+	};
+
+private:
+	struct worker_t {
+		uint8_t bus;
+		std::vector<int> devices;
+		std::thread thread;
+		std::unique_ptr<SPSCRing<sample_t>> ring;
+		std::atomic<uint64_t> dropped;
+	};
+
+	std::vector<std::unique_ptr<ICM20948>> imus;
+	std::vector<std::unique_ptr<worker_t>> workers;
+	std::vector<sample_t> merged;					// consumer-side staging for popSamples()
+	std::atomic<bool> running;
+	void workerLoop(worker_t* worker);
+
+	/* Debug Functions */
+	bool debug;
+	template <typename... Args>
+	void printe(const char* format, Args... args) { TRACE_ERROR(format, args...); if (debug) trace_console("ERROR", "IMU_Manager.cpp", format, args...); }
+	template <typename... Args>
+	void printi(const char* format, Args... args) { TRACE_INFO(format, args...); if (debug) trace_console("INFO", "IMU_Manager.cpp", format, args...); }
+
+public:
+	explicit IMUManager(bool debug = false);
+	~IMUManager();
+	IMUManager(const IMUManager&) = delete;
+	IMUManager& operator=(const IMUManager&) = delete;
+
+	int addIMU(uint8_t bus, uint8_t address = IMU_I2C_ADDR);	// returns the device index, -1 on error
+	int getIMUCount();
+	ICM20948* getIMU(int device);					// NULL while sampling or for an unknown device
+
+	int start(size_t capacity = MANAGER_CAPACITY);
+	void stop();
+	size_t popSamples(sample_t* samples, size_t max_samples);
+	uint64_t getDroppedSamples();
+};
+
+#endif // IMU_MANAGER_H
@@ -0,0 +1,194 @@
+/****************************************************************************
+ * IMU_Runner.cpp
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Real-time fixed-rate acquisition loop around the IMU, with
+ *              deadline, jitter and wake-up latency statistics.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include "IMU_Runner.h"
+#include "Trace.h"
+
+
+IMURunner::IMURunner(IMU& imu, const config_t& config) : imu(imu), config(config), running(false) {
+	period = 0;
+	realtime = pinned = locked = false;
+}
+
+IMURunner::~IMURunner() {
+	stop();
+}
+
+int IMURunner::start(handler_t handler) {
+	if (worker.joinable()) return -1;
+
+	float rate = (config.rate > 0) ? config.rate : imu.getDataRate();
+	if (rate <= 0) return -1;
+	pacer.setRate(rate);
+	period = pacer.getPeriod();
+	this->handler = handler;
+
+	cycles = overruns = missed = errors = 0;
+	latency = maxLatency = jitter = maxJitter = work = maxWork = 0;
+	for (int i = 0; i < I2C_METRICS_BUCKETS; i++) latencyBuckets[i] = jitterBuckets[i] = 0;
+	realtime = pinned = locked = false;
+
+	/* process-wide, so it is done here rather than by the loop */
+	if (config.lock_memory) {
+		locked = (mlockall(MCL_CURRENT | MCL_FUTURE) == 0);
+		if (!locked) TRACE_ERROR("mlockall failed (errno %d)", errno);
+	}
+
+	running = true;
+	worker = std::thread(&IMURunner::runLoop, this);
+
+	return 0;
+}
+
+void IMURunner::stop() {
+	if (!worker.joinable()) return;
+
+	running = false;					// seen within one period
+	worker.join();
+}
+
+bool IMURunner::isRunning() {
+	return worker.joinable();
+}
+
+
+/*********************************** Loop ***********************************/
+
+/* touches every page of a stack frame as large as the loop may ever need, so they are resident from then on */
+__attribute__((noinline)) static void prefaultStack() {
+	volatile uint8_t stack[RUNNER_STACK_PREFAULT];
+	for (size_t i = 0; i < sizeof(stack); i += 4096) stack[i] = 0;
+}
+
+void IMURunner::setupThread() {
+	/* the default 50 us of slack would be added to every wake-up of a non real-time thread */
+	prctl(PR_SET_TIMERSLACK, RUNNER_TIMER_SLACK_NS, 0, 0, 0);
+
+	if (config.cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(config.cpu, &set);
+		int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		pinned = (error == 0);
+		if (error != 0) TRACE_ERROR("the acquisition loop could not be pinned to cpu %d (errno %d)", config.cpu, error);
+	}
+
+	if (config.priority > 0) {
+		struct sched_param param;
+		param.sched_priority = config.priority;
+		int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		realtime = (error == 0);
+		if (error != 0) TRACE_ERROR("SCHED_FIFO priority %d was refused (errno %d)", config.priority, error);
+	}
+
+	if (locked) prefaultStack();
+}
+
+void IMURunner::runLoop() {
+	setupThread();
+
+	uint64_t lastWake = 0, lastDeadline = 0;
+
+	while (running.load(std::memory_order_relaxed)) {
+		uint64_t skipped = pacer.wait();
+		add(missed, skipped);
+
+		uint64_t woke = pacer.getWakeTime();
+		uint64_t deadline = pacer.getDeadline();
+		uint64_t late = (woke > deadline) ? woke - deadline : 0;
+		add(latency, late);
+		raise(maxLatency, late);
+		add(latencyBuckets[I2C_Metrics::bucket_of(late)], 1);
+
+		/* against the deadlines rather than the period, so skipped deadlines do not count as jitter */
+		if (lastWake != 0) {
+			int64_t deviation = (int64_t)(woke - lastWake) - (int64_t)(deadline - lastDeadline);
+			uint64_t error = (deviation < 0) ? -deviation : deviation;
+			add(jitter, error);
+			raise(maxJitter, error);
+			add(jitterBuckets[I2C_Metrics::bucket_of(error)], 1);
+		}
+		lastWake = woke;
+		lastDeadline = deadline;
+
+		ICM20948::raw_t sample = imu.getRawData();
+		if (sample.timestamp != 0) handler(sample);
+		else add(errors, 1);
+
+		uint64_t done = ICM20948::monotonicTime();
+		add(work, done - woke);
+		raise(maxWork, done - woke);
+		add(cycles, 1);
+
+		/* the next wait() returns at once, and skips whole periods that have gone by (counted as missed) */
+		if (done > pacer.getNext()) {
+			add(overruns, 1);
+			TRACE_ERROR("acquisition overrun: cycle took %llu ns", (unsigned long long)(done - woke));
+		}
+	}
+}
+
+
+/********************************* Statistics *******************************/
+
+uint64_t IMURunner::percentile(const std::atomic<uint64_t>* buckets, double p, uint64_t maximum) {
+	uint64_t total = 0;
+	for (int i = 0; i < I2C_METRICS_BUCKETS; i++) total += buckets[i].load(std::memory_order_relaxed);
+	if (total == 0) return 0;
+
+	uint64_t rank = (uint64_t)(p * total);
+	if (rank >= total) rank = total - 1;
+	uint64_t seen = 0;
+	for (int i = 0; i < I2C_METRICS_BUCKETS; i++) {
+		seen += buckets[i].load(std::memory_order_relaxed);
+		if (seen > rank) {
+			uint64_t limit = I2C_Metrics::bucket_limit(i);
+			return (limit < maximum) ? limit : maximum;
+		}
+	}
+
+	return maximum;
+}
+
+IMURunner::stats_t IMURunner::getStats() {
+	stats_t stats;
+	stats.cycles = cycles.load(std::memory_order_relaxed);
+	stats.overruns = overruns.load(std::memory_order_relaxed);
+	stats.missed = missed.load(std::memory_order_relaxed);
+	stats.errors = errors.load(std::memory_order_relaxed);
+	stats.period_ns = period;
+
+	uint64_t intervals = (stats.cycles > 1) ? stats.cycles - 1 : 0;
+	stats.latency_max_ns = maxLatency.load(std::memory_order_relaxed);
+	stats.latency_mean_ns = (stats.cycles > 0) ? latency.load(std::memory_order_relaxed) / stats.cycles : 0;
+	stats.latency_p99_ns = percentile(latencyBuckets, 0.99, stats.latency_max_ns);
+	stats.jitter_max_ns = maxJitter.load(std::memory_order_relaxed);
+	stats.jitter_mean_ns = (intervals > 0) ? jitter.load(std::memory_order_relaxed) / intervals : 0;
+	stats.jitter_p99_ns = percentile(jitterBuckets, 0.99, stats.jitter_max_ns);
+	stats.work_max_ns = maxWork.load(std::memory_order_relaxed);
+	stats.work_mean_ns = (stats.cycles > 0) ? work.load(std::memory_order_relaxed) / stats.cycles : 0;
+
+	stats.realtime = realtime;
+	stats.pinned = pinned;
+	stats.locked = locked;
+
+	return stats;
+}
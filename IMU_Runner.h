@@ -0,0 +1,113 @@
+/****************************************************************************
+ * IMU_Runner.h
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Real-time fixed-rate acquisition loop around the IMU, with
+ *              deadline, jitter and wake-up latency statistics.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#ifndef IMU_RUNNER_H
+#define IMU_RUNNER_H
+
+/********************************* Includes *********************************/
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include "imu.h"
+#include "Pacer.h"
+
+/********************************* Defines **********************************/
+#define RUNNER_STACK_PREFAULT (64 * 1024) 	// [B] stack touched once locked, so the loop never page faults on it
+#define RUNNER_TIMER_SLACK_NS 1 			// [ns] timer slack of the loop thread (the kernel default is 50 us)
+
+/********************************* IMURunner ********************************/
+
+/*
+ * Reads the IMU on a fixed grid of absolute CLOCK_MONOTONIC deadlines from a dedicated thread and hands every sample
+ * to 'handler' on that thread:
+ *
+ *     IMURunner::config_t config;
+ *     config.rate = 1000;  config.priority = 80;  config.cpu = 3;  config.lock_memory = true;
+ *     IMURunner runner(imu, config);
+ *     runner.start([&](const ICM20948::raw_t& sample) { log.write(sample); });
+ *
+ * The thread optionally runs SCHED_FIFO at 'priority', pinned to 'cpu', with the process memory locked (mlockall)
+ * and its stack prefaulted, so neither the scheduler nor paging can delay a deadline. Each setting that cannot be
+ * applied (typically EPERM without CAP_SYS_NICE/CAP_IPC_LOCK or an rtprio limit) is traced and reported in stats_t,
+ * and the loop runs anyway.
+ *
+ * The deadlines come from a Pacer. A cycle that ends past the next deadline is an overrun: the next sample is read
+ * late, right away, and whole periods that have already gone by are skipped (missed) so the grid stays aligned. The handler runs inside the
+ * deadline, so it must not block; hand samples to IMULogWriter's asynchronous mode or a ring instead.
+ *
+ * While it runs, the runner owns the IMU in the same way as the background sampler, so the two are exclusive.
+ */
+class IMURunner {
+public:
+	struct config_t {
+		float rate = 0;					// [Hz], 0 uses the IMU's output data rate
+		int priority = 0;				// SCHED_FIFO priority 1..99, 0 keeps the default scheduler
+		int cpu = -1;					// core to pin the loop to, -1 for any
+		bool lock_memory = false;		// mlockall(MCL_CURRENT | MCL_FUTURE) for the whole process
+	};
+
+	struct stats_t {
+		uint64_t cycles;				// deadlines served
+		uint64_t overruns;				// cycles that ended past the next deadline
+		uint64_t missed;				// deadlines skipped after overruns
+		uint64_t errors;				// cycles whose read failed, not handed to the handler
+		uint64_t period_ns;
+		uint64_t latency_mean_ns, latency_p99_ns, latency_max_ns;	// wake-up time past the deadline
+		uint64_t jitter_mean_ns, jitter_p99_ns, jitter_max_ns;		// |wake-up interval - deadline interval|
+		uint64_t work_mean_ns, work_max_ns;							// read + handler time per cycle
+		bool realtime, pinned, locked;	// whether the scheduling, affinity and memory locking took effect
+	};
+
+	typedef std::function<void(const ICM20948::raw_t& sample)> handler_t;
+
+private:
+	IMU& imu;
+	config_t config;
+	handler_t handler;
+	std::thread worker;
+	std::atomic<bool> running;
+	Pacer pacer;						// owned by the loop while it runs
+
+	/* single writer (the loop), updated with relaxed stores like I2C_Metrics */
+	std::atomic<uint64_t> cycles, overruns, missed, errors, latency, maxLatency, jitter, maxJitter, work, maxWork;
+	std::atomic<uint64_t> latencyBuckets[I2C_METRICS_BUCKETS], jitterBuckets[I2C_METRICS_BUCKETS];
+	std::atomic<bool> realtime, pinned, locked;
+	uint64_t period;					// [ns]
+
+	static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+	static void raise(std::atomic<uint64_t>& maximum, uint64_t value) {
+		if (value > maximum.load(std::memory_order_relaxed)) maximum.store(value, std::memory_order_relaxed);
+	}
+	static uint64_t percentile(const std::atomic<uint64_t>* buckets, double p, uint64_t maximum);
+
+	void setupThread();					// scheduling, affinity, timer slack and stack, from the loop thread
+	void runLoop();
+
+public:
+	IMURunner(IMU& imu, const config_t& config);
+	~IMURunner();
+	IMURunner(const IMURunner&) = delete;
+	IMURunner& operator=(const IMURunner&) = delete;
+
+	int start(handler_t handler);		// -1 if already running or the rate is unknown
+	void stop();
+	bool isRunning();
+	IMURunner::stats_t getStats();		// safe from any thread while running
+};
+
+#endif	// IMU_RUNNER_H
@@ -0,0 +1,90 @@
+/****************************************************************************
+ * Pacer.h
+ *
+ * About      : Sleeps a loop onto a fixed-rate grid of CLOCK_MONOTONIC
+ *              deadlines.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#ifndef PACER_H
+#define PACER_H
+
+/********************************* Includes *********************************/
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+
+/********************************** Pacer ***********************************/
+
+/*
+ * wait() returns once per period. Deadlines are absolute, so the time spent in the loop body does not accumulate as
+ * drift; when the body overruns by whole periods the missed deadlines are skipped (and counted) instead of being
+ * served back-to-back. After each wait(), getDeadline() and getWakeTime() tell how late the loop woke up, which is
+ * what IMURunner builds its latency and jitter statistics from.
+ */
+class Pacer {
+private:
+	uint64_t period;					// [ns], 0 disables pacing
+	uint64_t next;						// next deadline, 0 before the first wait()
+	uint64_t start, ticks, missed;
+	uint64_t deadline, woke;			// deadline served by the last wait() and when it returned
+
+	static uint64_t now() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+
+public:
+	explicit Pacer(float rate = 0) { setRate(rate); }
+
+	void setRate(float rate) {			// [Hz]
+		period = (rate > 0) ? (uint64_t)(1e9 / rate) : 0;
+		next = start = ticks = missed = 0;
+		deadline = woke = 0;
+	}
+
+	uint64_t wait() {					// returns the number of deadlines skipped to get back onto the grid
+		if (period == 0) return 0;
+
+		uint64_t t = now();
+		uint64_t behind = 0;
+		if (next == 0) {
+			next = start = t;
+		} else if (t > next + period) {
+			behind = (t - next) / period;
+			missed += behind;
+			next += behind * period;
+		}
+
+		struct timespec ts;
+		ts.tv_sec = next / 1000000000ULL;
+		ts.tv_nsec = next % 1000000000ULL;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+
+		woke = now();
+		deadline = next;
+		next += period;
+		ticks++;
+
+		return behind;
+	}
+
+	uint64_t getPeriod() { return period; }			// [ns]
+	uint64_t getNext() { return next; }				// [ns] deadline of the next wait(), 0 before the first
+	uint64_t getDeadline() { return deadline; }		// [ns] CLOCK_MONOTONIC
+	uint64_t getWakeTime() { return woke; }			// [ns] CLOCK_MONOTONIC
+	uint64_t getMissed() { return missed; }
+
+	float getAchievedRate() {			// [Hz] iterations per second since the first wait()
+		uint64_t elapsed = (ticks > 0) ? now() - start : 0;
+		return (elapsed > 0) ? (float)(ticks * 1e9 / elapsed) : 0;
+	}
+};
+
+#endif	// PACER_H
@@ -0,0 +1,111 @@
+/****************************************************************************
+ * SampleClock.cpp
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Maps sample indices of a batched stream onto CLOCK_MONOTONIC.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#include <math.h>
+#include <string.h>
+#include "SampleClock.h"
+
+
+#define FORGET (1.0 - 1.0 / CLOCK_FIT_WINDOW)
+
+
+SampleClock::SampleClock(float odr) {
+	memset(&stats, 0, sizeof(stats));
+	jitterSum = jitterSquares = 0;
+	setRate(odr);
+}
+
+void SampleClock::setRate(float odr) {
+	nominal = (odr > 0) ? 1e9 / odr : 0;
+	slope = nominal;
+	restart();
+	stats.restarts = 0;
+}
+
+void SampleClock::restart() {
+	started = false;
+	sw = sx = sy = sxx = sxy = 0;
+	intercept = 0;
+	stats.restarts++;
+}
+
+void SampleClock::observe(uint64_t index, uint64_t time) {
+	if (nominal <= 0) return;
+
+	if (!started) {
+		started = true;
+		originIndex = index;
+		originTime = time;
+		sw = 1;
+		intercept = 0;
+		return;
+	}
+
+	/* residual against the current fit, before this observation moves it */
+	double dx = (double)(int64_t)(index - originIndex);
+	double dy = (double)(int64_t)(time - originTime);
+	double residual = dy - (intercept + slope * dx);
+	stats.observations++;
+	jitterSum += residual;
+	jitterSquares += residual * residual;
+	if (fabs(residual) > stats.jitter_max_ns) stats.jitter_max_ns = fabs(residual);
+
+	/* move the origin to this observation, (x - dx, y - dy) for every point in the sums */
+	double osx = sx, osy = sy;
+	sxx = sxx - 2 * dx * osx + dx * dx * sw;
+	sxy = sxy - dx * osy - dy * osx + dx * dy * sw;
+	sx = osx - dx * sw;
+	sy = osy - dy * sw;
+	originIndex = index;
+	originTime = time;
+
+	/* forget old observations, then add this one at (0, 0) */
+	sw = sw * FORGET + 1;
+	sx *= FORGET;
+	sy *= FORGET;
+	sxx *= FORGET;
+	sxy *= FORGET;
+
+	fit();
+}
+
+void SampleClock::fit() {
+	double varX = sxx - sx * sx / sw;
+	if (sw >= 2 && varX > 1e-9) {
+		double b = (sxy - sx * sy / sw) / varX;
+		if (b < nominal * (1 - CLOCK_MAX_DRIFT)) b = nominal * (1 - CLOCK_MAX_DRIFT);
+		if (b > nominal * (1 + CLOCK_MAX_DRIFT)) b = nominal * (1 + CLOCK_MAX_DRIFT);
+		slope = b;
+	}
+	intercept = (sy - slope * sx) / sw;
+}
+
+uint64_t SampleClock::timeOf(uint64_t index) {
+	if (!started) return 0;
+
+	double offset = intercept + slope * (double)(int64_t)(index - originIndex);
+	return originTime + (int64_t)llround(offset);
+}
+
+SampleClock::stats_t SampleClock::getStats() {
+	stats_t out = stats;
+	out.period_ns = slope;
+	out.drift_ppm = (nominal > 0) ? (slope / nominal - 1) * 1e6 : 0;
+	if (stats.observations > 0) {
+		out.jitter_mean_ns = jitterSum / stats.observations;
+		out.jitter_rms_ns = sqrt(jitterSquares / stats.observations);
+	}
+
+	return out;
+}
@@ -0,0 +1,68 @@
+/****************************************************************************
+ * SampleClock.h
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Maps sample indices of a batched stream onto CLOCK_MONOTONIC.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#ifndef SAMPLE_CLOCK_H
+#define SAMPLE_CLOCK_H
+
+/********************************* Includes *********************************/
+#include <stdint.h>
+
+/********************************* Defines **********************************/
+#define CLOCK_FIT_WINDOW  64 			// observations the fit effectively remembers
+#define CLOCK_MAX_DRIFT   0.05 			// fitted period is kept within +-5% of the nominal one
+
+/******************************* SampleClock ********************************/
+
+/*
+ * Batched reads (the FIFO) deliver many samples per bus transaction, so only the time of the read is known. Each read
+ * is an observation "sample #k, the newest one, existed at time t". The clock fits t = a + b * k by least squares over
+ * the last ~CLOCK_FIT_WINDOW observations (exponential forgetting), which averages out the read latency and tracks
+ * the sensor's oscillator drift (b is the real sample period, not the nominal one), and then stamps every sample with
+ * timeOf(k). The residuals of the observations against the fit are the read jitter.
+ *
+ * The sums are kept relative to the latest observation, so precision does not degrade over days of samples.
+ */
+class SampleClock {
+public:
+	struct stats_t {
+		uint64_t observations;
+		uint32_t restarts;				// continuity breaks, e.g. FIFO resets after an overflow
+		double period_ns;				// fitted sample period
+		double drift_ppm;				// fitted versus nominal period
+		double jitter_mean_ns;			// observation residuals against the fit
+		double jitter_rms_ns;
+		double jitter_max_ns;			// largest absolute residual
+	};
+
+private:
+	double nominal;						// [ns] period from the configured ODR
+	bool started;
+	uint64_t originIndex, originTime;	// latest observation, the fit's origin
+	double sw, sx, sy, sxx, sxy;		// weighted sums relative to the origin
+	double intercept, slope;			// time of originIndex relative to originTime, period [ns]
+	stats_t stats;
+	double jitterSum, jitterSquares;
+	void fit();
+
+public:
+	explicit SampleClock(float odr = 0);
+	void setRate(float odr);			// [Hz] nominal rate, restarts the fit
+	void restart();						// forget the observations but keep the fitted period
+	void observe(uint64_t index, uint64_t time);
+	uint64_t timeOf(uint64_t index);	// CLOCK_MONOTONIC [ns] of sample 'index', 0 before the first observation
+	double getPeriod() { return slope; }
+	SampleClock::stats_t getStats();
+};
+
+#endif	// SAMPLE_CLOCK_H
@@ -0,0 +1,77 @@
+/****************************************************************************
+ * SampleRing.h
+ *
+ * About      : Lock-free single-producer/single-consumer ring buffer.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+/********************************* Includes *********************************/
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+/********************************** Defines *********************************/
+#define CACHE_LINE_SIZE 64
+
+/********************************* SPSCRing *********************************/
+
+/*
+ * Exactly one thread may push and exactly one (other) thread may pop. Neither side ever blocks or takes a lock: the
+ * producer owns 'head', the consumer owns 'tail', and each only reads the other's index. The capacity is rounded up
+ * to a power of two so that indices wrap with a mask.
+ */
+template <typename T>
+class SPSCRing {
+private:
+	std::vector<T> buf;
+	size_t mask;
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> head;		// next slot to write, only written by the producer
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail;		// next slot to read, only written by the consumer
+
+public:
+	explicit SPSCRing(size_t capacity) : head(0), tail(0) {
+		size_t size = 1;
+		while (size < capacity) size <<= 1;
+		buf.resize(size);
+		mask = size - 1;
+	}
+
+	SPSCRing(const SPSCRing&) = delete;
+	SPSCRing& operator=(const SPSCRing&) = delete;
+
+	size_t capacity() const { return mask + 1; }
+	size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+
+	/* producer side: returns false (and drops 'item') when the ring is full */
+	bool push(const T& item) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) > mask) return false;
+
+		buf[h & mask] = item;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* consumer side: moves up to 'max' items into 'out', returns how many */
+	size_t pop(T* out, size_t max) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		size_t available = head.load(std::memory_order_acquire) - t;
+		size_t n = (available < max) ? available : max;
+
+		for (size_t i = 0; i < n; i++) {
+			out[i] = buf[(t + i) & mask];
+		}
+		tail.store(t + n, std::memory_order_release);
+		return n;
+	}
+};
+
+#endif	// SAMPLE_RING_H
@@ -0,0 +1,78 @@
+/****************************************************************************
+ * Seqlock.h
+ *
+ * About      : Single-writer/many-reader sequence lock for small POD values.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+/********************************* Includes *********************************/
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+/********************************** Seqlock *********************************/
+
+/*
+ * One writer publishes values, any number of readers take consistent copies. The writer never waits for readers and
+ * readers never write shared state, so they do not contend with each other; a reader that overlaps a write simply
+ * retries. The sequence is odd while a write is in progress and advances by two per published value.
+ *
+ * The payload is stored as relaxed atomic words so that the racy copy is well-defined in the C++ memory model.
+ */
+template <typename T>
+class Seqlock {
+	static_assert(std::is_trivially_copyable<T>::value, "Seqlock requires a trivially copyable type");
+
+private:
+	static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	std::atomic<uint64_t> seq;
+	std::atomic<uint64_t> words[WORDS];
+
+public:
+	Seqlock() : seq(0) {
+		for (size_t i = 0; i < WORDS; i++) words[i].store(0, std::memory_order_relaxed);
+	}
+
+	Seqlock(const Seqlock&) = delete;
+	Seqlock& operator=(const Seqlock&) = delete;
+
+	/* writer side, must not be called concurrently with itself */
+	void store(const T& value) {
+		uint64_t buf[WORDS] = {0};
+		memcpy(buf, &value, sizeof(T));
+
+		uint64_t s = seq.load(std::memory_order_relaxed);
+		seq.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (size_t i = 0; i < WORDS; i++) words[i].store(buf[i], std::memory_order_relaxed);
+		seq.store(s + 2, std::memory_order_release);
+	}
+
+	/* reader side: copies the latest value and returns how many values have been published so far (0 = none) */
+	uint64_t load(T& value) const {
+		uint64_t buf[WORDS];
+		uint64_t before, after;
+
+		do {
+			before = seq.load(std::memory_order_acquire);
+			for (size_t i = 0; i < WORDS; i++) buf[i] = words[i].load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = seq.load(std::memory_order_relaxed);
+		} while ((before & 1) || before != after);
+
+		memcpy(&value, buf, sizeof(T));
+		return before / 2;
+	}
+};
+
+#endif	// SEQLOCK_H
@@ -0,0 +1,436 @@
+/****************************************************************************
+ * SimICM20948.cpp
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit (simulated)
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : An in-process ICM20948 register map behind the I2C_Transport
+ *              interface, for running the driver without the board.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include "SimICM20948.h"
+
+
+#define SIM_TEMPERATURE 25.0f 			// [degC]
+#define SIM_FIELD_NORTH 20.0f 			// [uT] horizontal component of the earth's field
+#define SIM_FIELD_UP    -45.0f 			// [uT] vertical component, pointing down in the northern hemisphere
+#define SIM_WIA1        0x48 			// AK09916 company ID
+#define SIM_INT_STATUS  0x19 			// INT_STATUS through INT_STATUS_3 are read-only
+#define SIM_INT_STATUS_3 0x1C
+#define SIM_MAG_ST1     0x10
+#define SIM_PWR_RESET   0x41 			// PWR_MGMT_1 at power-on: asleep, auto clock
+#define SIM_CONFIG_RESET 0x01 			// GYRO_CONFIG_1/ACCEL_CONFIG_1 at power-on: DLPF on, lowest full scale
+
+#define DEVICE_RESET_BM (1 << 7) 		// PWR_MGMT_1
+#define SLEEP_BM        (1 << 6) 		// PWR_MGMT_1
+#define FIFO_MODE_SNAPSHOT (1 << 0) 	// FIFO_MODE, FIFO 0
+#define FIFO_OVERFLOW_BM   (1 << 0) 	// INT_STATUS_2, FIFO 0
+#define SLV_LEN_BM      0x0F 			// I2C_SLVx_CTRL, bytes per transfer
+#define MAG_MODE_BM     0x1F 			// MAG_CNTL2
+#define MAG_DRDY_BM     (1 << 0) 		// ST1
+
+
+SimICM20948::SimICM20948(uint8_t address) {
+	this->address = address;
+	motion.yaw_rate = 90.0f;
+	motion.frequency = 0.5f;
+	motion.roll = 0.0f;
+	motion.noise = 0.0f;
+	driftPpm = 0;
+	transferNs = byteNs = 0;
+	fifo.resize(FIFO_SIZE);
+	reset();
+}
+
+void SimICM20948::reset() {
+	std::lock_guard<std::mutex> guard(lock);
+	powerOn();
+}
+
+void SimICM20948::powerOn() {
+	memset(regs, 0, sizeof(regs));
+	regs[0][WHO_AM_I] = 0xEA;
+	regs[0][PWR_MGMT_1] = SIM_PWR_RESET;
+	regs[2][GYRO_CONFIG_1] = SIM_CONFIG_RESET;
+	regs[2][ACCEL_CONFIG_1] = SIM_CONFIG_RESET;
+	bank = 0;
+	pointer = 0;
+
+	memset(mag, 0, sizeof(mag));
+	mag[0] = SIM_WIA1;
+	mag[MAG_WIA2] = MAG_DEVICE_ID;
+
+	memset(&stats, 0, sizeof(stats));
+	noiseState = 0x2545F491;			// fixed seed, runs are reproducible
+	fifoHead = fifoCount = 0;
+	lastSample = 0;
+	rebase(ICM20948::monotonicTime());
+}
+
+void SimICM20948::setMotion(const motion_t& motion) {
+	std::lock_guard<std::mutex> guard(lock);
+	this->motion = motion;
+}
+
+void SimICM20948::setDrift(float ppm) {
+	std::lock_guard<std::mutex> guard(lock);
+	driftPpm = ppm;
+	rebase(ICM20948::monotonicTime());
+}
+
+void SimICM20948::setLatency(uint32_t transfer_ns, uint32_t byte_ns) {
+	std::lock_guard<std::mutex> guard(lock);
+	transferNs = transfer_ns;
+	byteNs = byte_ns;
+}
+
+void SimICM20948::step(uint32_t samples) {
+	std::lock_guard<std::mutex> guard(lock);
+	if (regs[0][PWR_MGMT_1] & SLEEP_BM) return;
+
+	for (uint32_t i = 0; i < samples; i++) render(++lastSample);
+	baseSample += samples;				// the clock driven samples carry on from here
+	stats.samples += samples;
+}
+
+uint8_t SimICM20948::peek(uint8_t bank, uint8_t reg) {
+	std::lock_guard<std::mutex> guard(lock);
+	return regs[bank & 3][reg & 0x7F];
+}
+
+SimICM20948::stats_t SimICM20948::getStats() {
+	std::lock_guard<std::mutex> guard(lock);
+	return stats;
+}
+
+
+/******************************* Transactions *******************************/
+
+int SimICM20948::transfer(struct i2c_rdwr_ioctl_data* rdwr) {
+	uint64_t start = ICM20948::monotonicTime();
+	uint64_t bytes = 0;
+	int done = 0;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		transferTime = start;
+		advance(start);				// the whole transaction sees one instant, like a burst read of the chip
+
+		for (; done < (int)rdwr->nmsgs; done++) {
+			struct i2c_msg& msg = rdwr->msgs[done];
+			if (msg.addr != address) break;		// nobody acknowledges
+
+			if (msg.flags & I2C_M_RD) {
+				for (int i = 0; i < msg.len; i++) msg.buf[i] = readReg();
+			} else if (msg.len > 0) {
+				pointer = msg.buf[0] & 0x7F;
+				for (int i = 1; i < msg.len; i++) writeReg(msg.buf[i]);
+			}
+			bytes += msg.len + 1;
+		}
+
+		stats.transfers++;
+		stats.messages += done;
+		stats.bytes += bytes;
+	}
+
+	hold(start, bytes);
+
+	if (done < (int)rdwr->nmsgs) {
+		errno = ENXIO;
+		return -1;
+	}
+
+	return done;
+}
+
+/*
+ * The SPI face of the chip: the chip select frames the register accesses, the first byte of a frame is the register
+ * address with bit 7 set for a read, and the bytes after it are written to, or clocked out of, consecutive registers
+ * (FIFO_R_W excepted, as on I2C). The chip select drops after a transfer with cs_change set and at the end of the
+ * message. Returns the bytes transferred, like the SPI_IOC_MESSAGE ioctl.
+ */
+int SimICM20948::spiExchange(const struct spi_ioc_transfer* xfers, uint32_t count) {
+	uint64_t start = ICM20948::monotonicTime();
+	uint64_t bytes = 0;
+	uint64_t frames = 0;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		transferTime = start;
+		advance(start);
+
+		bool selected = false, reading = false;
+		for (uint32_t i = 0; i < count; i++) {
+			const uint8_t* tx = (const uint8_t*)(uintptr_t)xfers[i].tx_buf;		// no tx buffer clocks out zeros
+			uint8_t* rx = (uint8_t*)(uintptr_t)xfers[i].rx_buf;
+			for (uint32_t j = 0; j < xfers[i].len; j++) {
+				uint8_t in = tx ? tx[j] : 0;
+				uint8_t out = 0;
+				if (!selected) {
+					selected = true;
+					reading = in & 0x80;
+					pointer = in & 0x7F;
+					frames++;
+				} else if (reading) {
+					out = readReg();
+				} else {
+					writeReg(in);
+				}
+				if (rx) rx[j] = out;
+			}
+			bytes += xfers[i].len;
+			if (xfers[i].cs_change) selected = false;
+		}
+
+		stats.transfers++;
+		stats.messages += frames;
+		stats.bytes += bytes;
+	}
+
+	hold(start, bytes);
+
+	return (int)bytes;
+}
+
+/* holds the caller (and, through I2C_Bus, the bus) for as long as the wire would */
+void SimICM20948::hold(uint64_t start, uint64_t bytes) {
+	uint64_t latency = transferNs + bytes * byteNs;
+	if (latency == 0) return;
+
+	uint64_t end = start + latency;
+	struct timespec deadline;
+	deadline.tv_sec = end / 1000000000ULL;
+	deadline.tv_nsec = end % 1000000000ULL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR);
+}
+
+uint8_t SimICM20948::readReg() {
+	uint8_t reg = pointer;
+	uint8_t value = regs[bank][reg];
+
+	if (bank == 0) {
+		switch (reg) {
+			case FIFO_R_W:
+				/* pops instead of advancing, an empty FIFO reads as 0xFF */
+				if (fifoCount == 0) return 0xFF;
+				value = fifo[fifoHead];
+				fifoHead = (fifoHead + 1) % FIFO_SIZE;
+				fifoCount--;
+				return value;
+			case FIFO_COUNTH: value = (fifoCount >> 8) & (FIFO_COUNT_BM >> 8); break;
+			case FIFO_COUNTL: value = fifoCount & 0xFF; break;
+			case INT_STATUS_2:
+			case I2C_MST_STATUS: regs[0][reg] = 0; break;		// cleared on read
+		}
+	}
+
+	pointer = (reg + 1) & 0x7F;
+	return value;
+}
+
+void SimICM20948::writeReg(uint8_t value) {
+	uint8_t reg = pointer;
+	pointer = (reg + 1) & 0x7F;
+
+	if (reg == REG_BANK_SEL) {
+		bank = (value >> 4) & 3;
+		for (int b = 0; b < 4; b++) regs[b][REG_BANK_SEL] = value & (3 << 4);
+		return;
+	}
+
+	if (bank == 0) {
+		/* read-only: identity, status, sensor data and the FIFO count */
+		if (reg == WHO_AM_I || reg == I2C_MST_STATUS || (reg >= SIM_INT_STATUS && reg <= SIM_INT_STATUS_3)) return;
+		if ((reg >= ACCEL_XOUT_H && reg < EXT_SLV_SENS_DATA_00 + 24) || reg == FIFO_COUNTH || reg == FIFO_COUNTL) return;
+		if (reg == FIFO_R_W) return;
+
+		if (reg == PWR_MGMT_1 && (value & DEVICE_RESET_BM)) {
+			powerOn();
+			return;
+		}
+
+		regs[0][reg] = value;
+		if (reg == FIFO_RST && (value & FIFO_ALL_BM)) fifoHead = fifoCount = 0;
+		if (reg == PWR_MGMT_1) rebase(transferTime);
+		return;
+	}
+
+	regs[bank][reg] = value;
+
+	/* rate and range changes take effect from the next sample */
+	if (bank == 2 && (reg == GYRO_SMPLRT_DIV || reg == GYRO_CONFIG_1 || reg == ACCEL_SMPLRT_DIV_1 ||
+	                  reg == ACCEL_SMPLRT_DIV_2 || reg == ACCEL_CONFIG_1)) {
+		rebase(transferTime);
+	}
+
+	if (bank == 3 && reg == I2C_SLV4_CTRL && (value & SLV_EN)) {
+		runSLV4();
+		regs[3][I2C_SLV4_CTRL] &= ~SLV_EN;		// single transfer, self-clearing
+	}
+}
+
+/* performs the auxiliary master's single transfer right away instead of at the next sample */
+void SimICM20948::runSLV4() {
+	if (!(regs[0][USER_CTRL] & I2C_MST_EN_BM)) return;		// master off, the transfer never completes
+
+	uint8_t slvAddr = regs[3][I2C_SLV4_ADDR];
+	uint8_t reg = regs[3][I2C_SLV4_REG];
+	if ((slvAddr & 0x7F) != MAG_I2C_ADDR || reg >= SIM_MAG_REGS) {
+		regs[0][I2C_MST_STATUS] |= SLV4_NACK_BM;
+		return;
+	}
+
+	if (slvAddr & SLV_READ) {
+		regs[3][I2C_SLV4_DI] = mag[reg];
+	} else if (reg == MAG_CNTL3 && (regs[3][I2C_SLV4_DO] & MAG_SRST)) {
+		memset(mag, 0, sizeof(mag));
+		mag[0] = SIM_WIA1;
+		mag[MAG_WIA2] = MAG_DEVICE_ID;
+	} else if (reg == MAG_CNTL2) {
+		mag[MAG_CNTL2] = regs[3][I2C_SLV4_DO] & MAG_MODE_BM;
+	}
+
+	regs[0][I2C_MST_STATUS] |= SLV4_DONE_BM;
+}
+
+
+/********************************* Sampling *********************************/
+
+float SimICM20948::dataRate() {
+	float acc = ACCEL_BYPASS_ODR, gyro = GYRO_BYPASS_ODR;
+	if (regs[2][ACCEL_CONFIG_1] & FCHOICE_BM) {
+		int div = ((regs[2][ACCEL_SMPLRT_DIV_1] & 0x0F) << 8) | regs[2][ACCEL_SMPLRT_DIV_2];
+		acc = ACCEL_BASE_ODR / (1 + div);
+	}
+	if (regs[2][GYRO_CONFIG_1] & FCHOICE_BM) gyro = GYRO_BASE_ODR / (1 + regs[2][GYRO_SMPLRT_DIV]);
+
+	return (acc > gyro) ? acc : gyro;
+}
+
+void SimICM20948::rebase(uint64_t now) {
+	baseSample = lastSample;
+	baseTime = now;
+	period = 1e9 / dataRate() * (1 + driftPpm * 1e-6);
+}
+
+void SimICM20948::advance(uint64_t now) {
+	/* asleep: no samples, and the grid restarts once the sensor wakes up */
+	if (regs[0][PWR_MGMT_1] & SLEEP_BM) {
+		rebase(now);
+		return;
+	}
+
+	uint64_t due = baseSample + (uint64_t)((double)(now - baseTime) / period);
+	if (due <= lastSample) return;
+
+	/* after a long gap only the most recent FIFO_SIZE samples can still matter, even at one byte per packet */
+	uint64_t first = lastSample + 1;
+	if (due - first > FIFO_SIZE) first = due - FIFO_SIZE;
+	for (uint64_t k = first; k <= due; k++) render(k);
+
+	stats.samples += due - lastSample;
+	lastSample = due;
+}
+
+int16_t SimICM20948::toCounts(float value, float sens) {
+	float counts = value * sens;
+	if (motion.noise > 0) {
+		noiseState ^= noiseState << 13;		// xorshift32
+		noiseState ^= noiseState >> 17;
+		noiseState ^= noiseState << 5;
+		counts += motion.noise * ((float)noiseState / 2147483648.0f - 1.0f);
+	}
+
+	if (counts > INT16_MAX) return INT16_MAX;
+	if (counts < INT16_MIN) return INT16_MIN;
+	return (int16_t)lroundf(counts);
+}
+
+/*
+ * The sensor sits rolled by 'roll' and yaws about the vertical with rate w(t) = A sin(2 pi f t). In the sensor frame
+ * that is a rotation rate of (0, sin(roll), cos(roll)) * w, gravity reads (0, sin(roll), cos(roll)) g, and the
+ * earth's field is rotated by the yaw angle, the integral of w, then by the roll.
+ */
+void SimICM20948::render(uint64_t sample) {
+	double t = sample / (double)dataRate();		// on the sensor's own clock
+	double w = 2 * M_PI * motion.frequency;
+	double rate = motion.yaw_rate * sin(w * t);
+	double yaw = (w > 0) ? motion.yaw_rate * (1 - cos(w * t)) / w * (M_PI / 180) : 0;
+	double sr = sin(motion.roll * M_PI / 180), cr = cos(motion.roll * M_PI / 180);
+
+	float accSens = 16384 >> ((regs[2][ACCEL_CONFIG_1] & SENSITIVITY_BM) >> 1);
+	float gyroSens = 131.0f / (1 << ((regs[2][GYRO_CONFIG_1] & SENSITIVITY_BM) >> 1));
+
+	int16_t data[7];
+	data[0] = toCounts(0, accSens);
+	data[1] = toCounts(sr, accSens);
+	data[2] = toCounts(cr, accSens);
+	data[3] = toCounts(0, gyroSens);
+	data[4] = toCounts(sr * rate, gyroSens);
+	data[5] = toCounts(cr * rate, gyroSens);
+	data[6] = (int16_t)lroundf((SIM_TEMPERATURE - TEMP_ROOM) * TEMP_SENS + TEMP_ROOM);
+
+	uint8_t packet[IMU_DATA_LEN];
+	for (int i = 0; i < 7; i++) {
+		packet[2 * i] = (uint16_t)data[i] >> 8;
+		packet[2 * i + 1] = (uint16_t)data[i] & 0xFF;
+	}
+	memcpy(&regs[0][ACCEL_XOUT_H], packet, IMU_DATA_LEN);
+
+	/* AK09916, little-endian in its own axes (X, -Y, -Z of the accelerometer) */
+	if (mag[MAG_CNTL2] & MAG_MODE_BM) {
+		double north = cos(yaw) * SIM_FIELD_NORTH, west = -sin(yaw) * SIM_FIELD_NORTH;
+		double field[3] = {north, -(cr * west + sr * SIM_FIELD_UP), -(-sr * west + cr * SIM_FIELD_UP)};
+		for (int i = 0; i < 3; i++) {
+			int16_t counts = toCounts(field[i], MAG_SENS);
+			mag[MAG_HXL + 2 * i] = (uint16_t)counts & 0xFF;
+			mag[MAG_HXL + 2 * i + 1] = (uint16_t)counts >> 8;
+		}
+		mag[SIM_MAG_ST1] |= MAG_DRDY_BM;
+	}
+
+	/* SLV0 copies its registers into EXT_SLV_SENS_DATA_00 once per sample */
+	uint8_t slv0Addr = regs[3][I2C_SLV0_ADDR], slv0Ctrl = regs[3][I2C_SLV0_CTRL];
+	if ((regs[0][USER_CTRL] & I2C_MST_EN_BM) && (slv0Ctrl & SLV_EN) && slv0Addr == (SLV_READ | MAG_I2C_ADDR)) {
+		int reg = regs[3][I2C_SLV0_REG], len = slv0Ctrl & SLV_LEN_BM;
+		for (int i = 0; i < len; i++) regs[0][EXT_SLV_SENS_DATA_00 + i] = (reg + i < SIM_MAG_REGS) ? mag[reg + i] : 0;
+		if (reg <= MAG_ST2 && reg + len > MAG_ST2) mag[SIM_MAG_ST1] &= ~MAG_DRDY_BM;	// reading ST2 releases the data
+	}
+
+	/* FIFO, in the data register order: accelerometer, gyroscope, temperature */
+	if (!(regs[0][USER_CTRL] & FIFO_EN_BM)) return;
+	uint8_t sources = regs[0][FIFO_EN_2];
+	uint8_t fifoPacket[IMU_DATA_LEN];
+	int len = 0;
+	if (sources & ACCEL_FIFO_EN) { memcpy(&fifoPacket[len], &packet[0], 6); len += 6; }
+	for (int axis = 0; axis < 3; axis++) {
+		if (sources & (1 << (axis + 1))) { memcpy(&fifoPacket[len], &packet[6 + 2 * axis], 2); len += 2; }
+	}
+	if (sources & TEMP_FIFO_EN) { memcpy(&fifoPacket[len], &packet[12], 2); len += 2; }
+	if (len > 0) pushFIFO(fifoPacket, len);
+}
+
+void SimICM20948::pushFIFO(const uint8_t* packet, int len) {
+	if (fifoCount + len > FIFO_SIZE) {
+		regs[0][INT_STATUS_2] |= FIFO_OVERFLOW_BM;
+		stats.fifo_overflows++;
+
+		/* snapshot mode drops the new packet, stream mode the oldest bytes */
+		if (regs[0][FIFO_MODE] & FIFO_MODE_SNAPSHOT) return;
+		int excess = fifoCount + len - FIFO_SIZE;
+		fifoHead = (fifoHead + excess) % FIFO_SIZE;
+		fifoCount -= excess;
+	}
+
+	for (int i = 0; i < len; i++) fifo[(fifoHead + fifoCount + i) % FIFO_SIZE] = packet[i];
+	fifoCount += len;
+}
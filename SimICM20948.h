@@ -0,0 +1,140 @@
+/****************************************************************************
+ * SimICM20948.h
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit (simulated)
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : An in-process ICM20948 register map behind the I2C_Transport
+ *              interface, for running the driver without the board.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#ifndef SIM_ICM20948_H
+#define SIM_ICM20948_H
+
+/********************************* Includes *********************************/
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "I2C_Transport.h"
+#include "ICM20948.h"
+
+/********************************* Defines **********************************/
+#define SIM_BYTE_NS_100KHZ 90000 		// [ns] one byte plus ACK on a 100 kHz bus
+#define SIM_BYTE_NS_400KHZ 22500 		// [ns] same at 400 kHz
+#define SIM_BYTE_NS_7MHZ   1143 			// [ns] one byte of an SPI burst at 7 MHz
+#define SIM_MAG_REGS       0x40 			// AK09916 register space covered (through MAG_CNTL3)
+
+/******************************* SimICM20948 ********************************/
+
+/*
+ * Answers I2C_RDWR transactions like an ICM20948 at 'address' would, so the unmodified driver can be run, profiled
+ * and regression-tested on any Linux machine:
+ *
+ *     auto sim = std::make_shared<SimICM20948>();
+ *     I2C_Bus::attach(2, sim);			// everything on bus 2 now talks to the simulator
+ *     IMU imu;
+ *
+ * Modelled: the four register banks and REG_BANK_SEL, auto-incrementing burst reads and writes (FIFO_R_W pops
+ * instead), the sample rate dividers, FCHOICE and the full scale ranges, sleep, the FIFO in stream and snapshot mode
+ * with its overflow flag, and the AK09916 behind the I2C master (SLV4 single transfers, SLV0 auto-reads into
+ * EXT_SLV_SENS_DATA_00). Samples are generated on CLOCK_MONOTONIC at the configured ODR, optionally skewed by a clock
+ * drift, and follow a consistent rigid body motion: the sensor, tilted by a fixed roll, yaws back and forth about the
+ * vertical, so the gyroscope, gravity and the earth's field agree with each other and an AHRS can be checked against
+ * it. Every transaction can be delayed to mimic the bus. The same register map also answers SPI frames, see
+ * SimICM20948SPI.
+ *
+ * Not modelled: the DMP, the interrupt pins, self-test, and the low-pass filters' effect on the signal.
+ */
+class SimICM20948 : public I2C_Transport {
+public:
+	struct motion_t {
+		float yaw_rate;					// [dps] amplitude of the yaw rate
+		float frequency;				// [Hz] of the yaw oscillation
+		float roll;						// [deg] fixed tilt about the sensor's X axis
+		float noise;					// [LSB] uniform noise added to every channel, 0 for exact data
+	};
+
+	struct stats_t {
+		uint64_t transfers, messages, bytes;	// messages are SPI frames on SPI; bytes include every address byte
+		uint64_t samples;						// generated since the last reset
+		uint64_t fifo_overflows;
+	};
+
+private:
+	uint8_t address;
+	std::mutex lock;
+	uint8_t regs[4][128];
+	uint8_t bank;						// selected by REG_BANK_SEL, 0..3
+	uint8_t pointer;					// register address of the next byte
+	uint8_t mag[SIM_MAG_REGS];			// AK09916 registers
+
+	motion_t motion;
+	float driftPpm;
+	uint32_t transferNs, byteNs;
+	uint32_t noiseState;
+	stats_t stats;
+
+	/* sample timing, rebased whenever the rate changes */
+	uint64_t transferTime;				// CLOCK_MONOTONIC [ns] at the start of the current transaction
+	uint64_t baseTime;					// CLOCK_MONOTONIC [ns] of sample 'baseSample'
+	uint64_t baseSample, lastSample;
+	double period;						// [ns] real, drift included
+
+	/* FIFO */
+	std::vector<uint8_t> fifo;			// FIFO_SIZE ring
+	int fifoHead, fifoCount;
+
+	void powerOn();						// reset() without the lock, also run by DEVICE_RESET
+	void advance(uint64_t now);			// generates the samples due by 'now'
+	void rebase(uint64_t now);			// restarts the sample grid at the current ODR
+	float dataRate();
+	void render(uint64_t sample);		// sample -> data, EXT_SLV_SENS_DATA and FIFO registers
+	void pushFIFO(const uint8_t* packet, int len);
+	int16_t toCounts(float value, float sens);
+	uint8_t readReg();
+	void writeReg(uint8_t value);
+	void runSLV4();
+	void hold(uint64_t start, uint64_t bytes);	// sleeps out the latency of a transaction
+
+public:
+	explicit SimICM20948(uint8_t address = IMU_I2C_ADDR);
+	int transfer(struct i2c_rdwr_ioctl_data* rdwr) override;
+	int spiExchange(const struct spi_ioc_transfer* xfers, uint32_t count);	// the same chip wired to SPI
+
+	void reset();								// power-on register values, empty FIFO
+	void setMotion(const motion_t& motion);
+	void setDrift(float ppm);					// sample period error, + runs slow (as SampleClock::stats_t)
+	void setLatency(uint32_t transfer_ns, uint32_t byte_ns);	// per transaction, per byte (SIM_BYTE_NS_*)
+	void step(uint32_t samples);				// generates samples right away, ahead of the clock (e.g. to fill the FIFO)
+	uint8_t peek(uint8_t bank, uint8_t reg);	// register contents without read side effects
+	SimICM20948::stats_t getStats();
+};
+
+
+/****************************** SimICM20948SPI ******************************/
+
+/*
+ * Puts a SimICM20948 behind I2C_SPITransport in place of /dev/spidevX.Y, so the transaction to frame translation and
+ * the framing itself are exercised end to end:
+ *
+ *     I2C_Bus::attach(2, std::make_shared<SimICM20948SPI>(sim));
+ */
+class SimICM20948SPI : public I2C_SPITransport {
+private:
+	std::shared_ptr<SimICM20948> sim;
+
+protected:
+	int exchange(struct spi_ioc_transfer* xfers, uint32_t count) override { return sim->spiExchange(xfers, count); }
+
+public:
+	explicit SimICM20948SPI(std::shared_ptr<SimICM20948> sim, uint8_t address = IMU_I2C_ADDR)
+		: I2C_SPITransport("", address), sim(sim) {}
+};
+
+#endif	// SIM_ICM20948_H
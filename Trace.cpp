@@ -0,0 +1,216 @@
+/****************************************************************************
+ * Trace.cpp
+ *
+ * About      : Compile-time gated binary tracing into a lock-free ring,
+ *              decoded off the hot path.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include "Trace.h"
+
+
+static_assert((TRACE_CAPACITY & (TRACE_CAPACITY - 1)) == 0, "TRACE_CAPACITY must be a power of two");
+
+/*
+ * Bounded multi-producer ring (D. Vyukov's sequence-per-slot queue). A producer claims a position with one CAS on
+ * 'head' and publishes its slot by storing position + 1 into the slot's sequence; the consumer frees the slot by
+ * storing position + TRACE_CAPACITY. A slot whose sequence lags the claimed position is still owned by the consumer,
+ * which means the ring is full and the record is dropped rather than waited for.
+ */
+struct trace_slot_t {
+	std::atomic<uint64_t> sequence;
+	trace_record_t record;
+};
+
+static trace_slot_t slots[TRACE_CAPACITY];
+static std::atomic<uint64_t> head(0);
+static uint64_t tail = 0;						// consumer side, guarded by drainLock
+static std::mutex drainLock;
+static std::atomic<uint64_t> dropped(0);
+static std::atomic<uint32_t> threads(0);
+static std::once_flag ready;
+
+static void initSlots() {
+	for (uint64_t i = 0; i < TRACE_CAPACITY; i++) slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+/* sequences are set up on first use, so pushing from static initializers is safe too */
+static inline void ensureReady() {
+	static std::atomic<bool> initialized(false);
+	if (initialized.load(std::memory_order_acquire)) return;
+	std::call_once(ready, initSlots);
+	initialized.store(true, std::memory_order_release);
+}
+
+
+/********************************* Producers ********************************/
+
+void trace_push(uint8_t level, const char* format, const int64_t* args, int nargs) {
+	ensureReady();
+	static thread_local uint32_t thread = threads.fetch_add(1, std::memory_order_relaxed) + 1;
+
+	uint64_t pos = head.load(std::memory_order_relaxed);
+	trace_slot_t* slot;
+	while (true) {
+		slot = &slots[pos & (TRACE_CAPACITY - 1)];
+		int64_t diff = (int64_t)(slot->sequence.load(std::memory_order_acquire) - pos);
+		if (diff == 0) {
+			if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+		} else if (diff < 0) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		} else {
+			pos = head.load(std::memory_order_relaxed);
+		}
+	}
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	trace_record_t& record = slot->record;
+	record.time = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	record.format = format;
+	record.thread = thread;
+	record.level = level;
+	record.nargs = (uint8_t)nargs;
+	for (int i = 0; i < nargs; i++) record.args[i] = args[i];
+
+	slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+uint64_t trace_dropped() {
+	return dropped.load(std::memory_order_relaxed);
+}
+
+
+/********************************* Consumer *********************************/
+
+static bool popLocked(trace_record_t& record) {
+	trace_slot_t* slot = &slots[tail & (TRACE_CAPACITY - 1)];
+	if (slot->sequence.load(std::memory_order_acquire) != tail + 1) return false;
+
+	record = slot->record;
+	slot->sequence.store(tail + TRACE_CAPACITY, std::memory_order_release);
+	tail++;
+
+	return true;
+}
+
+bool trace_pop(trace_record_t& record) {
+	ensureReady();
+	std::lock_guard<std::mutex> guard(drainLock);
+	return popLocked(record);
+}
+
+void trace_format(const trace_record_t& record, FILE* out) {
+	static const char* levels[] = {"", "ERROR", "INFO", "BUS"};
+	const char* level = (record.level <= TRACE_LEVEL_BUS) ? levels[record.level] : "?";
+	fprintf(out, "%llu.%09llu [%u] %s: ", (unsigned long long)(record.time / 1000000000ULL),
+	        (unsigned long long)(record.time % 1000000000ULL), record.thread, level);
+
+	/* every argument was widened to int64_t, so each conversion is rewritten with the ll modifier */
+	int arg = 0;
+	for (const char* p = record.format; *p != '\0'; p++) {
+		if (*p != '%') {
+			fputc(*p, out);
+			continue;
+		}
+		if (p[1] == '%') {
+			fputc('%', out);
+			p++;
+			continue;
+		}
+
+		char spec[32] = "%";
+		size_t len = 1;
+		for (p++; *p != '\0' && strchr("-+ #0123456789.", *p) != NULL && len < 16; p++) spec[len++] = *p;
+		while (*p == 'h' || *p == 'l' || *p == 'z' || *p == 'j' || *p == 't') p++;
+		if (*p == '\0') break;
+
+		int64_t value = (arg < record.nargs) ? record.args[arg++] : 0;
+		if (*p == 'c') {
+			spec[len++] = 'c';
+			spec[len] = '\0';
+			fprintf(out, spec, (int)value);
+		} else {
+			spec[len++] = 'l';
+			spec[len++] = 'l';
+			spec[len++] = strchr("diuxXo", *p) ? *p : 'd';
+			spec[len] = '\0';
+			fprintf(out, spec, (long long)value);
+		}
+	}
+
+	fputc('\n', out);
+}
+
+size_t trace_drain(FILE* out) {
+	ensureReady();
+	std::lock_guard<std::mutex> guard(drainLock);
+
+	size_t count = 0;
+	trace_record_t record;
+	while (popLocked(record)) {
+		trace_format(record, out);
+		count++;
+	}
+	if (count > 0) fflush(out);
+
+	return count;
+}
+
+
+/******************************* TraceDrainer *******************************/
+
+TraceDrainer::TraceDrainer() {
+	out = stdout;
+	periodMs = 0;
+	stopping = false;
+}
+
+TraceDrainer::~TraceDrainer() {
+	stop();
+}
+
+int TraceDrainer::start(FILE* out, int period_ms) {
+	if (worker.joinable() || out == NULL || period_ms <= 0) return -1;
+
+	this->out = out;
+	periodMs = period_ms;
+	stopping = false;
+	worker = std::thread(&TraceDrainer::drainLoop, this);
+
+	return 0;
+}
+
+void TraceDrainer::stop() {
+	if (!worker.joinable()) return;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	worker.join();
+}
+
+void TraceDrainer::drainLoop() {
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		bool stopped = wake.wait_for(guard, std::chrono::milliseconds(periodMs), [this] { return stopping; });
+
+		guard.unlock();
+		trace_drain(out);
+		guard.lock();
+
+		if (stopped) break;
+	}
+}
@@ -0,0 +1,124 @@
+/****************************************************************************
+ * Trace.h
+ *
+ * About      : Compile-time gated binary tracing into a lock-free ring,
+ *              decoded off the hot path.
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/********************************* Includes *********************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/********************************* Defines **********************************/
+#define TRACE_LEVEL_OFF    0
+#define TRACE_LEVEL_ERROR  1
+#define TRACE_LEVEL_INFO   2
+#define TRACE_LEVEL_BUS    3 			// every bus transaction
+
+#ifndef IMU_TRACE_LEVEL
+#define IMU_TRACE_LEVEL    TRACE_LEVEL_OFF 	// set with make TRACE=<level> (after a make clean)
+#endif
+
+#define TRACE_MAX_ARGS     6
+#define TRACE_CAPACITY     4096 		// records in the ring, a power of two
+
+/*
+ * TRACE_ERROR("FIFO overflow after %d packets", count) and friends. A statement above IMU_TRACE_LEVEL compiles to
+ * nothing, arguments included, so tracing costs nothing until it is built in. A built-in statement copies the format
+ * pointer and up to TRACE_MAX_ARGS integer arguments into the ring (a timestamp and a few stores, no formatting, no
+ * locks, no system calls); the text is only produced when the ring is drained. The format must be a string literal,
+ * with integer conversions only (%d, %u, %x, %c, any flags and width; length modifiers are ignored).
+ */
+#if IMU_TRACE_LEVEL >= TRACE_LEVEL_ERROR
+#define TRACE_ERROR(...) trace_record(TRACE_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define TRACE_ERROR(...) ((void)0)
+#endif
+
+#if IMU_TRACE_LEVEL >= TRACE_LEVEL_INFO
+#define TRACE_INFO(...) trace_record(TRACE_LEVEL_INFO, __VA_ARGS__)
+#else
+#define TRACE_INFO(...) ((void)0)
+#endif
+
+#if IMU_TRACE_LEVEL >= TRACE_LEVEL_BUS
+#define TRACE_BUS(...) trace_record(TRACE_LEVEL_BUS, __VA_ARGS__)
+#else
+#define TRACE_BUS(...) ((void)0)
+#endif
+
+/********************************** Records *********************************/
+
+struct trace_record_t {
+	uint64_t time;						// CLOCK_MONOTONIC [ns]
+	const char* format;
+	int64_t args[TRACE_MAX_ARGS];
+	uint32_t thread;					// small per-process thread number, in order of first trace
+	uint8_t level;
+	uint8_t nargs;
+};
+
+/* appends a record, or counts it as dropped if the ring is full; safe from any number of threads */
+void trace_push(uint8_t level, const char* format, const int64_t* args, int nargs);
+
+template <typename... Args>
+inline void trace_record(uint8_t level, const char* format, Args... args) {
+	static_assert(sizeof...(Args) <= TRACE_MAX_ARGS, "too many trace arguments");
+	const int64_t values[] = {0, (int64_t)args...};
+	trace_push(level, format, values + 1, sizeof...(Args));
+}
+
+/*
+ * The console side of the classes' printe()/printi(): "ERROR: <message> (<source>)". Only for setup and teardown
+ * messages; anything on a sampling path should be a TRACE_* statement alone.
+ */
+template <typename... Args>
+inline void trace_console(const char* prefix, const char* source, const char* format, Args... args) {
+	printf("%s: ", prefix);
+	printf(format, args...);
+	printf(" (%s)\n", source);
+	fflush(stdout);
+}
+
+bool trace_pop(trace_record_t& record);							// oldest record, false if the ring is empty
+void trace_format(const trace_record_t& record, FILE* out);		// one line of text
+size_t trace_drain(FILE* out);									// formats every pending record, returns how many
+uint64_t trace_dropped();										// records lost to a full ring
+
+/******************************* TraceDrainer *******************************/
+
+/* empties the ring into 'out' from a background thread, and once more on stop() */
+class TraceDrainer {
+private:
+	FILE* out;
+	int periodMs;
+	bool stopping;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::thread worker;
+
+	void drainLoop();
+
+public:
+	TraceDrainer();
+	~TraceDrainer();
+	TraceDrainer(const TraceDrainer&) = delete;
+	TraceDrainer& operator=(const TraceDrainer&) = delete;
+
+	int start(FILE* out = stdout, int period_ms = 100);	// -1 if already running
+	void stop();
+};
+
+#endif	// TRACE_H
@@ -0,0 +1,360 @@
+/****************************************************************************
+ * bench.cpp
+ *
+ * Hardware   : ICM20948 Inertial Measurement Unit (simulated)
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Microbenchmarks of the driver's public calls against the
+ *              simulated sensor. Run with: make bench
+ *
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "imu.h"
+#include "AHRS.h"
+#include "IMU_Codec.h"
+#include "IMU_Convert.h"
+#include "SimICM20948.h"
+
+#define BENCH_BUS      3 			// ICM20948 and I2C_Functions, IMU keeps its own sensor on bus 2
+#define BENCH_SPI_BUS  4 			// a third sensor behind the SPI transport
+#define BENCH_TIME_MS  200 			// minimum measuring time per benchmark
+#define BENCH_BATCH    1024 		// samples per call of the batch kernels
+#define BENCH_FIFO     32 			// packets per readFIFO()
+
+/*
+ * Every counter below is read before and after a run and divided by the number of operations:
+ *   ioctls    transactions handed to the transport, one I2C_RDWR ioctl each with the kernel backend
+ *   bytes     bytes on the wire, including the address byte of every message
+ *   syscalls  the ioctls plus every sleep, read/write and poll the code issued itself; the calls are intercepted at
+ *             link time (-Wl,--wrap, see the Makefile), vDSO calls such as clock_gettime() are free and not counted
+ *   allocs    operator new and malloc/calloc/realloc calls
+ */
+static std::atomic<uint64_t> transfers(0), wireBytes(0), syscalls(0), allocs(0);
+
+
+/****************************** Interception *******************************/
+
+extern "C" void* __real_malloc(size_t size);
+
+void* operator new(size_t size) {
+	allocs.fetch_add(1, std::memory_order_relaxed);
+	void* p = __real_malloc(size ? size : 1);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	allocs.fetch_add(1, std::memory_order_relaxed);
+	return __real_malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"		// the replacements above allocate with malloc
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+#pragma GCC diagnostic pop
+
+extern "C" {
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* p, size_t size);
+int __real_ioctl(int fd, unsigned long request, void* arg);
+int __real_usleep(useconds_t usec);
+int __real_nanosleep(const struct timespec* req, struct timespec* rem);
+int __real_clock_nanosleep(clockid_t clock, int flags, const struct timespec* req, struct timespec* rem);
+ssize_t __real_read(int fd, void* buf, size_t count);
+ssize_t __real_write(int fd, const void* buf, size_t count);
+int __real_poll(struct pollfd* fds, nfds_t nfds, int timeout);
+int __real_epoll_wait(int epfd, struct epoll_event* events, int maxevents, int timeout);
+
+void* __wrap_malloc(size_t size) { allocs++; return __real_malloc(size); }
+void* __wrap_calloc(size_t n, size_t size) { allocs++; return __real_calloc(n, size); }
+void* __wrap_realloc(void* p, size_t size) { allocs++; return __real_realloc(p, size); }
+int __wrap_ioctl(int fd, unsigned long request, ...) {
+	va_list args;
+	va_start(args, request);
+	void* arg = va_arg(args, void*);
+	va_end(args);
+	syscalls++;
+	return __real_ioctl(fd, request, arg);
+}
+int __wrap_usleep(useconds_t usec) { syscalls++; return __real_usleep(usec); }
+int __wrap_nanosleep(const struct timespec* req, struct timespec* rem) { syscalls++; return __real_nanosleep(req, rem); }
+int __wrap_clock_nanosleep(clockid_t clock, int flags, const struct timespec* req, struct timespec* rem) {
+	syscalls++;
+	return __real_clock_nanosleep(clock, flags, req, rem);
+}
+ssize_t __wrap_read(int fd, void* buf, size_t count) { syscalls++; return __real_read(fd, buf, count); }
+ssize_t __wrap_write(int fd, const void* buf, size_t count) { syscalls++; return __real_write(fd, buf, count); }
+int __wrap_poll(struct pollfd* fds, nfds_t nfds, int timeout) { syscalls++; return __real_poll(fds, nfds, timeout); }
+int __wrap_epoll_wait(int epfd, struct epoll_event* events, int maxevents, int timeout) {
+	syscalls++;
+	return __real_epoll_wait(epfd, events, maxevents, timeout);
+}
+}
+
+/* stands in for the kernel backend: counts what would have gone over the bus, then lets the simulator answer */
+class CountingTransport : public I2C_Transport {
+private:
+	std::shared_ptr<I2C_Transport> device;
+
+public:
+	explicit CountingTransport(std::shared_ptr<I2C_Transport> device) : device(device) {}
+
+	int transfer(struct i2c_rdwr_ioctl_data* rdwr) override {
+		transfers++;
+		syscalls++;
+		for (uint32_t i = 0; i < rdwr->nmsgs; i++) wireBytes += rdwr->msgs[i].len + 1;
+		return device->transfer(rdwr);
+	}
+};
+
+/* swallows the driver's debug output, so only the results reach stdout */
+class NullBuffer : public std::streambuf {
+protected:
+	int overflow(int c) override { return c; }
+};
+
+
+/********************************* Harness *********************************/
+
+static const char* filter = NULL;
+static int minTimeMs = BENCH_TIME_MS;
+
+/*
+ * Runs 'op' in growing rounds until a round lasts at least minTimeMs, and reports the last round. 'batch' divides
+ * the results for calls that process several samples. 'setup', if given, runs before every operation without being
+ * timed or counted (it must not touch the bus or allocate).
+ */
+static void bench(const char* name, std::function<void()> op, int batch = 1, std::function<void()> setup = nullptr) {
+	if (filter != NULL && strstr(name, filter) == NULL) return;
+
+	for (int i = 0; i < 8; i++) {			// warm up caches, shadow registers and lazily sized buffers
+		if (setup) setup();
+		op();
+	}
+
+	uint64_t n = 1, elapsed = 0, ioctls = 0, bytes = 0, calls = 0, news = 0;
+	while (true) {
+		ioctls = transfers;
+		bytes = wireBytes;
+		calls = syscalls;
+		news = allocs;
+		elapsed = 0;
+
+		if (setup) {
+			for (uint64_t i = 0; i < n; i++) {
+				setup();
+				uint64_t start = ICM20948::monotonicTime();
+				op();
+				elapsed += ICM20948::monotonicTime() - start;
+			}
+		} else {
+			uint64_t start = ICM20948::monotonicTime();
+			for (uint64_t i = 0; i < n; i++) op();
+			elapsed = ICM20948::monotonicTime() - start;
+		}
+
+		ioctls = transfers - ioctls;
+		bytes = wireBytes - bytes;
+		calls = syscalls - calls;
+		news = allocs - news;
+		if (elapsed >= (uint64_t)minTimeMs * 1000000 || n >= (1ULL << 40)) break;
+
+		/* aim the next round past the minimum time with some margin */
+		uint64_t target = (uint64_t)minTimeMs * 1200000;
+		n = (elapsed > 0 && target / elapsed < 100) ? n * (target / elapsed + 1) : n * 100;
+	}
+
+	double ops = (double)n * batch;
+	printf("%s,%llu,%.1f,%.3f,%.1f,%.3f,%.3f\n", name, (unsigned long long)(n * batch), elapsed / ops, ioctls / ops,
+	       bytes / ops, calls / ops, news / ops);
+	fflush(stdout);
+}
+
+
+/********************************* Benchmarks *******************************/
+
+int main(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--filter=", 9) == 0) filter = argv[i] + 9;
+		else if (strncmp(argv[i], "--time=", 7) == 0) minTimeMs = atoi(argv[i] + 7);
+		else {
+			fprintf(stderr, "usage: %s [--filter=substring] [--time=ms per benchmark]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	NullBuffer null;
+	std::streambuf* console = std::cout.rdbuf(&null);
+
+	/*
+	 * The simulators answer instantly, so ns/op is the host's own cost of each call. Every driver instance shadows
+	 * the bank register, hence one simulated sensor each.
+	 */
+	SimICM20948::motion_t motion = {90.0f, 0.5f, 10.0f, 4.0f};
+	std::shared_ptr<SimICM20948> sim = std::make_shared<SimICM20948>();
+	std::shared_ptr<SimICM20948> imuSim = std::make_shared<SimICM20948>();
+	sim->setMotion(motion);
+	imuSim->setMotion(motion);
+	I2C_Bus::attach(BENCH_BUS, std::make_shared<CountingTransport>(sim));
+	I2C_Bus::attach(2, std::make_shared<CountingTransport>(imuSim));
+	std::shared_ptr<SimICM20948> spiSim = std::make_shared<SimICM20948>();
+	spiSim->setMotion(motion);
+	I2C_Bus::attach(BENCH_SPI_BUS, std::make_shared<CountingTransport>(std::make_shared<SimICM20948SPI>(spiSim)));
+
+	ICM20948 icm(false, BENCH_BUS);
+	icm.disableSleep();
+	icm.resync();
+	IMU imu(false);
+	imu.disableSleep();
+	I2C_Functions dev(BENCH_BUS, IMU_I2C_ADDR);
+	std::shared_ptr<I2C_Bus> bus = I2C_Bus::get(BENCH_BUS);
+
+	printf("# convert kernel: %s\n", getConvertKernel());
+	printf("name,ops,ns_per_op,ioctls_per_op,bytes_per_op,syscalls_per_op,allocs_per_op\n");
+
+	/* transport level */
+	uint8_t raw[IMU_MAX_DATA_LEN];
+	uint16_t sequence[] = {(uint16_t)(IMU_I2C_ADDR << 1), ACCEL_XOUT_H, I2C_RESTART, (uint16_t)((IMU_I2C_ADDR << 1) | 1),
+	                       I2C_READ, I2C_READ, I2C_READ, I2C_READ, I2C_READ, I2C_READ, I2C_READ,
+	                       I2C_READ, I2C_READ, I2C_READ, I2C_READ, I2C_READ, I2C_READ, I2C_READ};
+	bench("I2C_Bus::send_sequence/burst14", [&] { bus->send_sequence(sequence, sizeof(sequence) / sizeof(sequence[0]), raw); });
+	bench("I2C_Functions::readn/burst14", [&] { dev.readn(ACCEL_XOUT_H, IMU_DATA_LEN, raw); });
+	bench("I2C_Functions::read", [&] { dev.read(WHO_AM_I); });
+	bench("I2C_Functions::read2", [&] { dev.read2(FIFO_COUNTH); });
+	uint8_t zero = 0;
+	bench("I2C_Functions::write", [&] { dev.write(INT_ENABLE_1, zero); });
+	bench("I2C_Functions::writen/2", [&] { uint8_t data[2] = {0, 0}; dev.writen(INT_ENABLE_1, data, 2); });
+	uint8_t queued[4][IMU_DATA_LEN];
+	bench("I2C_Queue::submit/4xburst14", [&] {
+		I2C_Queue queue;
+		for (int i = 0; i < 4; i++) queue.add_read(dev, ACCEL_XOUT_H, queued[i], IMU_DATA_LEN);
+		queue.submit();
+	}, 4);
+
+	/* ICM20948 */
+	volatile float sink;
+	bench("ICM20948::getIMUData", [&] { sink = icm.getIMUData().ax; });
+	bench("ICM20948::getRawData", [&] { sink = icm.getRawData().ax; });
+	bench("ICM20948::getAccData", [&] { sink = icm.getAccData().x; });
+	bench("ICM20948::getGyroData", [&] { sink = icm.getGyroData().x; });
+	bench("ICM20948::getTemperature", [&] { sink = icm.getTemperature(); });
+	bench("ICM20948::getDeviceID", [&] { sink = icm.getDeviceID(); });
+	bench("ICM20948::getAccSens", [&] { sink = icm.getAccSens(); });
+	bench("ICM20948::getDataRate", [&] { sink = icm.getDataRate(); });
+	I2C_Queue batch;
+	bench("ICM20948::queueIMUData", [&] { batch.clear(); icm.queueIMUData(batch, raw); batch.submit(); });
+	bench("ICM20948::decodeIMUData", [&] { ICM20948::imu_t s; icm.decodeIMUData(raw, true, s); sink = s.ax; });
+
+	icm.enableMag();
+	bench("ICM20948::getIMUData/mag", [&] { sink = icm.getIMUData().mx; });
+	icm.disableMag();
+
+	icm.enableFIFO(true);
+	std::vector<ICM20948::imu_t> fifo(BENCH_FIFO);
+	bench("ICM20948::getFIFOCount", [&] { sink = icm.getFIFOCount(); });
+	bench("ICM20948::readFIFO/imu_t", [&] { icm.readFIFO(fifo.data(), BENCH_FIFO); }, BENCH_FIFO,
+	      [&] { sim->step(BENCH_FIFO); });
+	std::vector<float> soa(8 * BENCH_FIFO);
+	std::vector<uint64_t> times(BENCH_FIFO);
+	ICM20948::soa_t fifoOut = {&soa[0], &soa[BENCH_FIFO], &soa[2 * BENCH_FIFO], &soa[3 * BENCH_FIFO], &soa[4 * BENCH_FIFO],
+	                           &soa[5 * BENCH_FIFO], &soa[6 * BENCH_FIFO], times.data()};
+	bench("ICM20948::readFIFO/soa_t", [&] { icm.readFIFO(fifoOut, BENCH_FIFO); }, BENCH_FIFO,
+	      [&] { sim->step(BENCH_FIFO); });
+	icm.disableFIFO();
+
+	/* the same calls through the SPI transport, frame translation included */
+	ICM20948 spiIcm(false, BENCH_SPI_BUS);
+	spiIcm.disableSleep();
+	I2C_Functions spiDev(BENCH_SPI_BUS, IMU_I2C_ADDR);
+	bench("I2C_SPITransport::readn/burst14", [&] { spiDev.readn(ACCEL_XOUT_H, IMU_DATA_LEN, raw); });
+	bench("I2C_SPITransport::write", [&] { spiDev.write(INT_ENABLE_1, zero); });
+	bench("ICM20948::getIMUData/spi", [&] { sink = spiIcm.getIMUData().ax; });
+
+	/* IMU */
+	bench("IMU::updateIMU", [&] { imu.updateIMU(); });
+	bench("IMU::getLatest", [&] { sink = imu.getLatest().data.ax; });
+	float arr[7];
+	bench("IMU::getIMUArr", [&] { imu.getIMUArr(arr); });
+
+	/* host-side kernels, no bus traffic */
+	std::vector<ICM20948::raw_t> samples(BENCH_BATCH);
+	for (int i = 0; i < BENCH_BATCH; i++) {
+		samples[i] = icm.getRawData();
+		samples[i].timestamp = 1000000000ULL + i * 888889ULL;
+	}
+	float accSens = icm.getAccSens(), gyroSens = icm.getGyroSens();
+	std::vector<float> out(7 * BENCH_BATCH);
+	ICM20948::soa_t batchOut = {&out[0], &out[BENCH_BATCH], &out[2 * BENCH_BATCH], &out[3 * BENCH_BATCH],
+	                            &out[4 * BENCH_BATCH], &out[5 * BENCH_BATCH], &out[6 * BENCH_BATCH], NULL};
+	bench("convertSamples/1024", [&] { convertSamples(samples.data(), BENCH_BATCH, accSens, gyroSens, batchOut); }, BENCH_BATCH);
+
+	DeltaEncoder encoder;
+	size_t blockLen = 0;
+	auto encodeBlock = [&] {
+		encoder.reset();
+		for (int i = 0; i < CODEC_BLOCK_RECORDS; i++) encoder.encode(samples[i]);
+		return encoder.finish(blockLen);
+	};
+	bench("DeltaEncoder::encode/256", [&] { encodeBlock(); }, CODEC_BLOCK_RECORDS);
+	const uint8_t* block = encodeBlock();
+	uint32_t payloadLen;
+	uint16_t count;
+	parseBlockHeader(block, payloadLen, count);
+	std::vector<ICM20948::raw_t> decoded(CODEC_BLOCK_RECORDS);
+	bench("decodeBlock/256", [&] { decodeBlock(block + CODEC_BLOCK_HEADER, payloadLen, count, decoded.data(), CODEC_BLOCK_RECORDS); },
+	      CODEC_BLOCK_RECORDS);
+
+	DeltaEncoder packer(true);
+	auto packBlock = [&] {
+		packer.reset();
+		for (int i = 0; i < CODEC_BLOCK_RECORDS; i++) packer.encode(samples[i]);
+		return packer.finish(blockLen);
+	};
+	bench("DeltaEncoder::encode/256/packed", [&] { packBlock(); }, CODEC_BLOCK_RECORDS);
+	const uint8_t* packed = packBlock();
+	parseBlockHeader(packed, payloadLen, count);
+	bench("decodeBlock/256/packed", [&] {
+		decodeBlock(packed + CODEC_BLOCK_HEADER, payloadLen, count, decoded.data(), CODEC_BLOCK_RECORDS, true);
+	}, CODEC_BLOCK_RECORDS);
+
+	std::vector<ICM20948::imu_t> converted(BENCH_BATCH);
+	for (int i = 0; i < BENCH_BATCH; i++) {
+		converted[i] = icm.getIMUData();
+		converted[i].timestamp = 1000000000ULL + i * 888889ULL;
+	}
+	AHRS madgwick(AHRS_MADGWICK), mahony(AHRS_MAHONY);
+	bench("AHRS::update/madgwick", [&] { madgwick.update(converted.data(), BENCH_BATCH); }, BENCH_BATCH);
+	bench("AHRS::update/mahony", [&] { mahony.update(converted.data(), BENCH_BATCH); }, BENCH_BATCH);
+
+	SampleClock clock(IMU_BASE_ODR);
+	uint64_t index = 0;
+	bench("SampleClock::observe", [&] { clock.observe(index, 1000000000ULL + index * 888889ULL); index += 16; });
+
+	I2C_Bus::attach(BENCH_BUS, nullptr);
+	I2C_Bus::attach(2, nullptr);
+	I2C_Bus::attach(BENCH_SPI_BUS, nullptr);
+	std::cout.rdbuf(console);						// 'null' is gone by the time std::cout is flushed at exit
+	return 0;
+}
@@ -15,9 +15,10 @@
 
 
 #include "imu.h"
+#include "Pacer.h"
 
 
-IMU::IMU(bool debug) {
+IMU::IMU(bool debug) : sampling(false), dropped(0), mx(0), my(0), mz(0) {
 	this->debug = debug;
 	int status = 0;
 
@@ -29,6 +30,10 @@ IMU::IMU(bool debug) {
 	if (status < 0) printe("IMU could not be initialized.");
 }
 
+IMU::~IMU() {
+	stopSampler();
+}
+
 bool IMU::isActive() {
 	return imu.whoAmI();
 }
@@ -49,10 +54,18 @@ uint16_t IMU::getStatus() {
 	return imu.getStatus();
 }
 
+uint8_t IMU::getDeviceID() {
+	return imu.getDeviceID();
+}
+
 ICM20948::imu_t IMU::getIMUData() {
 	return imu.getIMUData();
 }
 
+ICM20948::raw_t IMU::getRawData() {
+	return imu.getRawData();
+}
+
 float* IMU::getIMUArr(float* arr) {
 	/* requires {uint8_t arr[7];} prior to call. the values are returned in the 'arr' variable. */
 	ICM20948::imu_t data = getIMUData();
@@ -69,6 +82,8 @@ float* IMU::getIMUArr(float* arr) {
 
 void IMU::updateIMU() {
 	ICM20948::imu_t data = getIMUData();
+	if (data.timestamp == 0) return;				// the read failed, keep the previous sample
+	latest.store(data);
 	ax = data.ax; 
 	ay = data.ay; 
 	az = data.az; 
@@ -76,6 +91,151 @@ void IMU::updateIMU() {
 	gy = data.gy; 
 	gz = data.gz; 
 	temperature = data.temperature;
+	mx = data.mx;
+	my = data.my;
+	mz = data.mz;
+}
+
+/*
+ * The public floats are plain members, so reading them while another thread runs updateIMU() can tear a sample.
+ * Every sample read by updateIMU() or the background sampler is also published through a seqlock: any number of
+ * threads may call getLatest() concurrently, they never block the updating thread and never contend with each other.
+ */
+IMU::snapshot_t IMU::getLatest() {
+	snapshot_t snapshot;
+	snapshot.sequence = latest.load(snapshot.data);
+	return snapshot;
+}
+
+
+/***************************** Output Data Rate *****************************/
+
+float IMU::setDataRate(float rate) {
+	if (imu.setAccRate(rate) < 0 || imu.setGyroRate(rate) < 0) {
+		printe("The output data rate could not be set.");
+		return -1;
+	}
+
+	return imu.getDataRate();
+}
+
+float IMU::getDataRate() {
+	return imu.getDataRate();
+}
+
+
+/******************************* Magnetometer *******************************/
+
+int IMU::enableMag(uint8_t mode) {
+	return imu.enableMag(mode);
+}
+
+void IMU::disableMag() {
+	imu.disableMag();
+	mx = my = mz = 0;
+}
+
+
+/***************************** Data Ready Mode ******************************/
+
+int IMU::enableDataReady(WaitSource* source) {
+	if (source->getFd() < 0) {
+		printe("The data ready source is not available.");
+		return -1;
+	}
+
+	/* an invalid waiter would fail every wait() at once, and the callers' wait loops would spin */
+	waiter.reset(new DataReadyWaiter(source));
+	if (!waiter->isValid()) {
+		printe("The data ready source could not be watched (errno %d).", errno);
+		waiter.reset();
+		return -1;
+	}
+	if (imu.enableDataReadyInterrupt() < 0) {
+		waiter.reset();
+		return -1;
+	}
+
+	return 0;
+}
+
+void IMU::disableDataReady() {
+	imu.disableDataReadyInterrupt();
+	waiter.reset();
+}
+
+int IMU::waitDataReady(int timeout_ms) {
+	if (!waiter) {
+		printe("Data ready acquisition is not enabled.");
+		return -1;
+	}
+
+	int events = waiter->wait(timeout_ms);
+	return (events > 0) ? 1 : events;
+}
+
+int IMU::waitIMU(int timeout_ms) {
+	/* sleeps until the IMU signals a new sample, then reads it exactly once. returns 1 on update, 0 on timeout. */
+	int status = waitDataReady(timeout_ms);
+	if (status <= 0) return status;
+
+	updateIMU();
+	return 1;
+}
+
+
+/**************************** Background Sampler ****************************/
+
+/*
+ * The sampler thread takes over the bus: it reads samples (waiting on the data ready source when one is enabled)
+ * and pushes them into a lock-free ring, so the consumer never blocks on I2C. While it runs, the consumer should only
+ * call popSamples()/getDroppedSamples() and leave the other accessors alone, since they would share the ICM20948.
+ */
+int IMU::startSampler(size_t capacity) {
+	if (sampling) return 0;
+
+	ring.reset(new SPSCRing<ICM20948::imu_t>(capacity));
+	dropped = 0;
+	sampling = true;
+	sampler = std::thread(&IMU::samplerLoop, this);
+	printi("Background sampler started.");
+
+	return 0;
+}
+
+void IMU::stopSampler() {
+	if (!sampling) return;
+
+	sampling = false;
+	sampler.join();
+	printi("Background sampler stopped.");
+}
+
+void IMU::samplerLoop() {
+	Pacer pacer(waiter ? 0 : imu.getDataRate());			// without data ready, poll once per new sample
+
+	while (sampling.load(std::memory_order_relaxed)) {
+		if (waiter && waiter->wait(100) <= 0) continue;		// bounded wait so stopSampler() is honoured
+		pacer.wait();
+
+		ICM20948::imu_t data = imu.getIMUData();
+		if (data.timestamp == 0) continue;					// failed read, counted by getReadErrors()
+		latest.store(data);
+		if (!ring->push(data)) dropped.fetch_add(1, std::memory_order_relaxed);		// consumer fell behind
+	}
+}
+
+size_t IMU::popSamples(ICM20948::imu_t* samples, size_t max_samples) {
+	if (!ring) return 0;
+	return ring->pop(samples, max_samples);
+}
+
+uint64_t IMU::getDroppedSamples() {
+	return dropped.load(std::memory_order_relaxed);
+}
+
+uint32_t IMU::getReadErrors() {
+	return imu.getReadErrors();
 }
 
 
@@ -134,7 +294,7 @@ void IMU::updateGyro() {
 }
 
 
-int IMU::getGyroSens() {
+float IMU::getGyroSens() {
 	return imu.getGyroSens();
 }
 
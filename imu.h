@@ -22,10 +22,17 @@
 #include <stdio.h>
 #include <string>
 #include <iostream>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include "ICM20948.h"
+#include "DataReady.h"
+#include "SampleRing.h"
+#include "Seqlock.h"
 
 
 /********************************* Defines **********************************/
+#define SAMPLER_CAPACITY 1024 		// default number of samples buffered by the background sampler
 
 
 
@@ -34,24 +41,68 @@
 class IMU {
 private:
 	ICM20948 imu;
+	std::unique_ptr<DataReadyWaiter> waiter;		// set while data ready acquisition is enabled
+
+	/* Background Sampler */
+	std::thread sampler;
+	std::atomic<bool> sampling;
+	std::atomic<uint64_t> dropped;
+	std::unique_ptr<SPSCRing<ICM20948::imu_t>> ring;
+	void samplerLoop();
+
+	/* Latest Sample */
+	Seqlock<ICM20948::imu_t> latest;				// written by updateIMU()/the sampler, read by getLatest()
 
 	/* Debug Functions */
 	bool debug;
-	void printe(std::string str) { if (debug) std::cout << "ERROR: " << str << " (imu.cpp)" << std::endl; }
-	void printi(std::string str) { if (debug) std::cout << "INFO: " << str << " (imu.cpp)" << std::endl; }
+	template <typename... Args>
+	void printe(const char* format, Args... args) { TRACE_ERROR(format, args...); if (debug) trace_console("ERROR", "imu.cpp", format, args...); }
+	template <typename... Args>
+	void printi(const char* format, Args... args) { TRACE_INFO(format, args...); if (debug) trace_console("INFO", "imu.cpp", format, args...); }
 
 public:
-	float ax, ay, az, gx, gy, gz, temperature;
+	float ax, ay, az, gx, gy, gz, temperature;		// not thread-safe, see getLatest()
+	float mx, my, mz;								// only updated while the magnetometer is enabled
+
+	struct snapshot_t {
+		uint64_t sequence;							// number of samples published so far, 0 if none yet
+		ICM20948::imu_t data;
+	};
 
 	explicit IMU(bool debug = false);
+	~IMU();
 	bool isActive();
 	void disableSleep();
 	void enableSleep();
 	float getTemperature();
 	uint16_t getStatus();
+	uint8_t getDeviceID();
 	ICM20948::imu_t getIMUData();
+	ICM20948::raw_t getRawData();
 	float* getIMUArr(float* arr);
 	void updateIMU();
+	IMU::snapshot_t getLatest();					// consistent copy of the newest sample, safe from any thread
+
+	/* output data rate */
+	float setDataRate(float rate);					// [Hz] both sensors, returns the rate actually achieved or -1
+	float getDataRate();							// the sampler polls at this rate without data ready
+
+	/* magnetometer */
+	int enableMag(uint8_t mode = MAG_MODE_100HZ);	// adds mx, my, mz to every sample at no extra bus cost
+	void disableMag();
+
+	/* data ready acquisition */
+	int enableDataReady(WaitSource* source);		// 'source' must outlive the IMU or disableDataReady()
+	void disableDataReady();
+	int waitDataReady(int timeout_ms = DRDY_TIMEOUT_INF);	// 1 once a new sample is ready, 0 on timeout
+	int waitIMU(int timeout_ms = DRDY_TIMEOUT_INF);			// waitDataReady() followed by updateIMU()
+
+	/* background sampler */
+	int startSampler(size_t capacity = SAMPLER_CAPACITY);
+	void stopSampler();
+	size_t popSamples(ICM20948::imu_t* samples, size_t max_samples);
+	uint64_t getDroppedSamples();
+	uint32_t getReadErrors();						// samples lost to failed bus reads, never pushed or published
 
 	/* accelerometer */
 	ICM20948::acc_t getAccData();
@@ -64,7 +115,7 @@ public:
 	ICM20948::gyro_t getGyroData();
 	float* getGyroArr(float* arr);
 	void updateGyro();
-	int getGyroSens();
+	float getGyroSens();
 	void setGyroSens(uint8_t scale);
 
 };
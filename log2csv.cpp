@@ -0,0 +1,61 @@
+/****************************************************************************
+ * log2csv.cpp
+ * 
+ * Hardware   : ICM20948 Inertial Measurement Unit
+ * Manual     : TDK DS-000189, Revision 1.3
+ * About      : Converts a binary IMU log (see IMU_Log.h) into a .csv file.
+ * 
+ * Author     : Carlos Carrasquillo
+ * Date       : October 18, 2026
+ * Modified   : October 18, 2026
+ * Proprty of : ADAMUS Lab
+ ****************************************************************************/
+
+#include <stdio.h>
+#include "IMU_Log.h"
+#include "IMU_Convert.h"
+
+#define BATCH 1024      // samples converted per pass
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s <log> [csv]   (writes to stdout without [csv])\n", argv[0]);
+        return 1;
+    }
+
+    IMULogReader log;
+    if (log.open(argv[1]) < 0) {
+        fprintf(stderr, "%s: not a readable IMU log\n", argv[1]);
+        return 1;
+    }
+
+    FILE* out = (argc == 3) ? fopen(argv[2], "w") : stdout;
+    if (out == NULL) {
+        fprintf(stderr, "%s: cannot be created\n", argv[2]);
+        return 1;
+    }
+
+    const imulog_header_t& header = log.getHeader();
+    fprintf(out, "# device_id: 0x%02x, odr: %.3f Hz, acc_sens: %.3f LSB/g, gyro_sens: %.3f LSB/dps\n",
+            header.device_id, header.odr, header.acc_sens, header.gyro_sens);
+    fprintf(out, "time,ax,ay,az,gx,gy,gz,temperature\n");
+
+    static ICM20948::raw_t samples[BATCH];
+    static float scaled[7][BATCH];
+    ICM20948::soa_t soa = {scaled[0], scaled[1], scaled[2], scaled[3], scaled[4], scaled[5], scaled[6]};
+
+    size_t n;
+    do {
+        for (n = 0; n < BATCH && log.next(samples[n]); n++);
+        convertSamples(samples, n, header.acc_sens, header.gyro_sens, soa);
+
+        for (size_t i = 0; i < n; i++) {
+            double t = (double)(int64_t)(samples[i].timestamp - header.start_time) * 1e-9; // seconds since the start
+            fprintf(out, "%.9f,%f,%f,%f,%f,%f,%f,%f\n", t, soa.ax[i], soa.ay[i], soa.az[i],
+                    soa.gx[i], soa.gy[i], soa.gz[i], soa.temperature[i]);
+        }
+    } while (n == BATCH);
+
+    if (out != stdout) fclose(out);
+    return 0;
+}
@@ -55,7 +55,10 @@ int i2c_open(uint8_t bus) {
     if(bus > 9) return -1;        /* sanity check */
     snprintf(device_name, DEVICE_NAME_LENGTH, "/dev/i2c-%d", bus);
     if((handle = open(device_name, O_RDWR)) < 0) return handle;
-    if(!check_i2c_functionality(handle)) return -1;
+    if(!check_i2c_functionality(handle)) {
+        close(handle);
+        return -1;
+    }
     return handle;
 }
 
@@ -81,36 +84,33 @@ static uint32_t count_segments(uint16_t *sequence, uint32_t sequence_length) {
 
 
 /*
-  Sends a command/data sequence that can include restarts, writes and reads. Every transmission begins with a START,
-  and ends with a STOP so you do not have to specify that.
-  sequence is the I2C operation sequence that should be performed. It can include any number of writes, restarts and
-  reads. Note that the sequence is composed of uint16_t, not uint8_t. This is because we have to support out-of-band
-  signalling of I2C_RESTART and I2C_READ operations, while still passing through 8-bit data.
-  sequence_length is the number of sequence elements (not bytes). Sequences of arbitrary length are supported, but
-  there is an upper limit on the number of segments (restarts): no more than 42. The minimum sequence length is
-  (rather obviously) 2.
-  received_data should point to a buffer that can hold as many bytes as there are I2C_READ operations in the
-  sequence. If there are no reads, 0 can be passed, as this parameter will not be used.
+  Translates a command/data sequence into the struct i2c_msg array expected by the I2C_RDWR ioctl, without performing
+  it. See i2c_send_sequence() for the sequence format.
+  scratch is caller-provided memory that receives the message array and the bytes to be written, so no memory is
+  allocated. It must be suitably aligned for struct i2c_msg (malloc'd memory or a uint64_t array is) and hold at least
+  (segments * sizeof(struct i2c_msg) + sequence_length) bytes; I2C_SCRATCH_SIZE(sequence_length) is always enough.
+  message_sequence is filled out so that it can be passed to ioctl(handle, I2C_RDWR, ...). It points into scratch and
+  received_data, so both must stay alive until the ioctl has been performed. Returns 0, or -1 in case of an error.
 */
-int i2c_send_sequence(int handle, uint16_t *sequence, uint32_t sequence_length, uint8_t *received_data) {
-    struct i2c_rdwr_ioctl_data message_sequence;
-    uint32_t number_of_segments = count_segments(sequence, sequence_length);
-    struct i2c_msg *messages = malloc(number_of_segments * sizeof(struct i2c_msg));
+int i2c_build_sequence(uint16_t *sequence, uint32_t sequence_length, uint8_t *received_data,
+                       void *scratch, uint32_t scratch_size, struct i2c_rdwr_ioctl_data *message_sequence) {
+    uint32_t number_of_segments;
+    struct i2c_msg *messages = scratch;
     struct i2c_msg *current_message = messages;
-    /* msg_buf needs to hold all *bytes written* in the entire sequence. Since it is difficult to estimate that number
-       without processing the sequence, we make an upper-bound guess: sequence_length. Yes, this is inefficient, but
-       optimizing this doesn't seem to be worth the effort. */
-    uint8_t *msg_buf = malloc(sequence_length); /* certainly no more than that */
-    uint8_t *msg_cur_buf_ptr = msg_buf;
+    uint8_t *msg_cur_buf_ptr;
     uint8_t *msg_cur_buf_base;
     uint32_t msg_cur_buf_size;
     uint8_t address;
     uint8_t rw;
     uint32_t i;
-    int result = -1;
 
-    if(sequence_length < 2) goto i2c_send_sequence_cleanup;
-    if((number_of_segments > I2C_RDRW_IOCTL_MAX_MSGS)) goto i2c_send_sequence_cleanup;
+    if(sequence_length < 2) return -1;
+    number_of_segments = count_segments(sequence, sequence_length);
+    if((number_of_segments > I2C_RDRW_IOCTL_MAX_MSGS)) return -1;
+    /* msg_buf needs to hold all *bytes written* in the entire sequence. We use the same upper-bound guess as before:
+       sequence_length. */
+    if(scratch_size < number_of_segments * sizeof(struct i2c_msg) + sequence_length) return -1;
+    msg_cur_buf_ptr = (uint8_t *)(messages + number_of_segments);
 
     address = sequence[0];        /* the first byte is always an address */
     rw = address & 1;
@@ -148,14 +148,49 @@ int i2c_send_sequence(int handle, uint16_t *sequence, uint32_t sequence_length,
         i++;
     }
 
-    message_sequence.msgs = messages;
-    message_sequence.nmsgs = number_of_segments;
+    message_sequence->msgs = messages;
+    message_sequence->nmsgs = number_of_segments;
+
+    return 0;
+}
 
-    result = ioctl(handle, I2C_RDWR, (unsigned long)(&message_sequence));
 
-    i2c_send_sequence_cleanup:
-    free(msg_buf);
-    free(messages);
+/*
+  Same as i2c_send_sequence(), but builds the messages in caller-provided scratch space (see i2c_build_sequence())
+  instead of allocating it, so it can be used on paths that must not touch the heap.
+*/
+int i2c_send_sequence_r(int handle, uint16_t *sequence, uint32_t sequence_length, uint8_t *received_data,
+                        void *scratch, uint32_t scratch_size) {
+    struct i2c_rdwr_ioctl_data message_sequence;
+
+    if(i2c_build_sequence(sequence, sequence_length, received_data, scratch, scratch_size, &message_sequence) < 0)
+        return -1;
+
+    return ioctl(handle, I2C_RDWR, (unsigned long)(&message_sequence));
+}
+
+
+/*
+  Sends a command/data sequence that can include restarts, writes and reads. Every transmission begins with a START,
+  and ends with a STOP so you do not have to specify that.
+  sequence is the I2C operation sequence that should be performed. It can include any number of writes, restarts and
+  reads. Note that the sequence is composed of uint16_t, not uint8_t. This is because we have to support out-of-band
+  signalling of I2C_RESTART and I2C_READ operations, while still passing through 8-bit data.
+  sequence_length is the number of sequence elements (not bytes). Sequences of arbitrary length are supported, but
+  there is an upper limit on the number of segments (restarts): no more than 42. The minimum sequence length is
+  (rather obviously) 2.
+  received_data should point to a buffer that can hold as many bytes as there are I2C_READ operations in the
+  sequence. If there are no reads, 0 can be passed, as this parameter will not be used.
+  The scratch space is allocated per call; use i2c_send_sequence_r() to supply it yourself.
+*/
+int i2c_send_sequence(int handle, uint16_t *sequence, uint32_t sequence_length, uint8_t *received_data) {
+    uint32_t scratch_size = count_segments(sequence, sequence_length) * sizeof(struct i2c_msg) + sequence_length;
+    void *scratch = malloc(scratch_size);
+    int result;
+
+    if(scratch == NULL) return -1;
+    result = i2c_send_sequence_r(handle, sequence, sequence_length, received_data, scratch, scratch_size);
+    free(scratch);
 
     return result;
 }
@@ -22,6 +22,7 @@
   SOFTWARE.
 
   Update: added extern "C"
+  Update: added allocation-free i2c_build_sequence() and i2c_send_sequence_r()
 */
 
 #ifndef LSQUAREDC_H
@@ -32,14 +33,26 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
 
 #define I2C_RESTART     1<<8    /* repeated start */
 #define I2C_READ		2<<8    /* read a byte */
 
+/* bytes of scratch space that always suffice for i2c_send_sequence_r() with a sequence of the given length */
+#define I2C_SCRATCH_SIZE(sequence_length) \
+    (I2C_RDRW_IOCTL_MAX_MSGS * sizeof(struct i2c_msg) + (sequence_length))
+
 int i2c_open(uint8_t bus);
 
 int i2c_send_sequence(int handle, uint16_t *sequence, uint32_t sequence_length, uint8_t *received_data);
 
+int i2c_send_sequence_r(int handle, uint16_t *sequence, uint32_t sequence_length, uint8_t *received_data,
+                        void *scratch, uint32_t scratch_size);
+
+int i2c_build_sequence(uint16_t *sequence, uint32_t sequence_length, uint8_t *received_data,
+                       void *scratch, uint32_t scratch_size, struct i2c_rdwr_ioctl_data *message_sequence);
+
 int i2c_close(int handle);
 
 #ifdef __cplusplus
@@ -3,7 +3,8 @@
  * 
  * Hardware   : ICM20948 Inertial Measurement Unit
  * Manual     : TDK DS-000189, Revision 1.3
- * About      : Creates a .csv file with accelerometer and gyroscope data.
+ * About      : Records accelerometer and gyroscope data into a binary log.
+ *              Convert it with: ./log2csv imu_test.imulog imu_test.csv
  * 
  * Author     : Carlos Carrasquillo
  * Date       : March 23, 2021
@@ -12,31 +13,82 @@
  ****************************************************************************/
 
 #include <iostream>
-#include <fstream>
 #include <chrono>
+#include <cmath>
+#include <memory>
 #include "imu.h"
+#include "IMU_Log.h"
+#include "IMU_Runner.h"
 
 #define DEBUG true
+#define DRDY_CHIP "/dev/gpiochip0"  // GPIO chip and line wired to the IMU's INT1 pin. with DRDY_LINE -1 the IMU is polled
+#define DRDY_LINE -1                // instead of waiting for its data ready interrupt.
+#define METRICS_FILE "imu_i2c.prom" // bus counters and latencies, rewritten every 5 seconds (Prometheus text format)
+#define RATE 1000                   // [Hz] sampling rate when polled, the ODR is set to the nearest rate at or above it
+#define RT_PRIORITY 80              // SCHED_FIFO priority of the sampling loop, 0 to run it as a normal thread
+#define RT_CPU 3                    // core reserved for the sampling loop (e.g. isolcpus=3), -1 for any
 
 int main() {
+    TraceDrainer trace;                                                                 // decodes the trace ring to stderr, if tracing
+    if (IMU_TRACE_LEVEL > TRACE_LEVEL_OFF) trace.start(stderr);                         // was built in (make TRACE=<level>)
+
     IMU imu(DEBUG);  // only one line of initialization required
 
+    float odr = imu.setDataRate(IMU_BASE_ODR / std::floor(IMU_BASE_ODR / RATE));      // 1125 / (1 + divider) >= RATE, so the
+    if (odr < 0) return 1;                                                              // polled loop never waits on stale data
+
     int dur = 30;                                                                       // program loops for 30 seconds
-    std::chrono::system_clock::time_point start = std::chrono::system_clock::now();     // start time for timer
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();     // start time for timer
     
-    std::ofstream file;
-    file.open("imu_test.csv");                                                          // write outputs to CSV file
+    IMULogWriter log;                                                                   // write raw samples to a compressed binary log,
+    imulog_header_t header = IMULogWriter::makeHeader(imu.getDeviceID(), imu.getAccSens(), imu.getGyroSens(), odr,
+                                                      IMULOG_ENC_PACKED);
+    if (log.openAsync("imu_test.imulog", header, ASYNC_DROP) < 0) {                     // never stalling on the SD card
+        std::cout << "ERROR: imu_test.imulog could not be created." << std::endl;
+        return 1;
+    }
+
+    I2C_MetricsExporter metrics;
+    metrics.start(METRICS_FILE, 5000);
+
+    std::unique_ptr<GPIOLineSource> drdy;
+    if (DRDY_LINE >= 0) {
+        drdy.reset(new GPIOLineSource(DRDY_CHIP, DRDY_LINE));
+        if (imu.enableDataReady(drdy.get()) < 0) drdy.reset();                         // fall back to polling
+    }
+
+    if (drdy) {
+        while(1) {
+            if (std::chrono::steady_clock::now() - start > std::chrono::seconds(dur)) break; // timer
 
-    while(1) {
-    	imu.updateIMU();   // update all IMU data
+            if (imu.waitDataReady(100) <= 0) continue;                                 // no new sample yet
 
-        file << std::to_string(imu.ax) <<  "," << std::to_string(imu.ay) << "," << std::to_string(imu.az) << ","
-             << std::to_string(imu.gx) <<  "," << std::to_string(imu.gy) << "," << std::to_string(imu.gz) << ","
-             << std::to_string(imu.temperature) << "\n";
+            ICM20948::raw_t sample = imu.getRawData();
+            if (sample.timestamp != 0) log.write(sample);                              // skip failed reads
+        }
+    } else {
+        IMURunner::config_t config;                                                     // polled on a fixed-rate real-time loop
+        config.rate = RATE;
+        config.priority = RT_PRIORITY;
+        config.cpu = RT_CPU;
+        config.lock_memory = true;
+        IMURunner runner(imu, config);
+        runner.start([&](const ICM20948::raw_t& sample) { log.write(sample); });
+        std::this_thread::sleep_until(start + std::chrono::seconds(dur));
+        runner.stop();
 
-        if (std::chrono::system_clock::now() - start > std::chrono::seconds(dur)) break; // timer
+        IMURunner::stats_t stats = runner.getStats();
+        std::cout << "INFO: " << stats.cycles << " cycles at " << 1e9 / stats.period_ns << " Hz, "
+                  << stats.overruns << " overruns, " << stats.missed << " missed, " << stats.errors << " failed reads. Wake-up latency mean/p99/max "
+                  << stats.latency_mean_ns / 1000.0 << "/" << stats.latency_p99_ns / 1000.0 << "/" << stats.latency_max_ns / 1000.0
+                  << " us, jitter " << stats.jitter_mean_ns / 1000.0 << "/" << stats.jitter_p99_ns / 1000.0 << "/"
+                  << stats.jitter_max_ns / 1000.0 << " us." << std::endl;
+        if (!stats.realtime || !stats.pinned || !stats.locked)
+            std::cout << "WARNING: the sampling loop runs without SCHED_FIFO, CPU pinning or locked memory "
+                         "(needs root or CAP_SYS_NICE and CAP_IPC_LOCK)." << std::endl;
     }
 
-    file.close();
+    if (log.getDroppedRecords() > 0) std::cout << "WARNING: " << log.getDroppedRecords() << " samples dropped by slow storage." << std::endl;
+    log.close();
     return 0;
 }
\ No newline at end of file